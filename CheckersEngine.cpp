@@ -1,14 +1,28 @@
 ﻿#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bit>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <csignal>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <sio_client.h>
 #include<bitset>
@@ -18,6 +32,28 @@
 #define __builtin_popcount _mm_popcnt_u32
 #endif
 
+// PEXT is part of BMI2, which every AVX2 target we build for also has
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define CHECKERS_HAS_PEXT
+#endif
+
+// Endgame tables are memory-mapped
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // Global random number generator (or define within scope)
 std::random_device rd;
 std::mt19937 rng(rd());
@@ -113,13 +149,35 @@ std::ostream& operator<<(std::ostream &os, const Move &m) {
     return os;
 }
 
+#ifdef CHECKERS_NNUE
+// Optional neural evaluator (see "NNUE evaluator" below); build with
+// CHECKERS_NNUE defined and pass --nnue <file> to use it
+constexpr int NNUE_INPUTS = 4 * 32;  // {white, black} x {man, king} x square
+constexpr int NNUE_HIDDEN1 = 64;
+constexpr int NNUE_HIDDEN2 = 32;
+#endif
+
+// A game is drawn after this many plies (40 moves a side) without a capture
+// or a man move
+constexpr int NO_PROGRESS_PLIES = 80;
+
 struct GameState {
     Bitboard white, black, kings, empty;
     bool whiteToMove;
+    uint8_t quietPlies;    // Plies since the last capture or man move
     uint32_t hash;
-    GameState() : white(0), black(0), kings(0), empty(0), whiteToMove(true), hash(0) {}
-    GameState(Bitboard w, Bitboard b, Bitboard k, Bitboard e, bool wtm, uint32_t h)
-        : white(w), black(b), kings(k), empty(e), whiteToMove(wtm), hash(h) {}
+    uint32_t menHash;      // Zobrist hash over the men only (no kings, no side to move)
+    uint32_t flippedHash;  // hash of the colour-flipped position, see flipColours
+#ifdef CHECKERS_NNUE
+    alignas(32) std::array<int16_t, NNUE_HIDDEN1> accumulator{};  // NNUE first layer output
+#endif
+    GameState()
+        : white(0), black(0), kings(0), empty(0), whiteToMove(true), quietPlies(0), hash(0), menHash(0),
+          flippedHash(0) {}
+    GameState(Bitboard w, Bitboard b, Bitboard k, Bitboard e, bool wtm, uint32_t h, uint32_t mh = 0,
+              uint32_t fh = 0)
+        : white(w), black(b), kings(k), empty(e), whiteToMove(wtm), quietPlies(0), hash(h), menHash(mh),
+          flippedHash(fh) {}
 
     inline Bitboard occupied() const noexcept { return white | black; }
     inline void updateEmpty() noexcept { empty = ~occupied(); }
@@ -130,8 +188,9 @@ constexpr uint32_t lcg(uint32_t seed) {
     return seed * 1664525UL + 1013904223UL;
 }
 
-constexpr std::array<uint32_t, 32> generateZobristKeys(uint32_t seed) {
-    std::array<uint32_t, 32> keys{};
+template <std::size_t N = 32>
+constexpr std::array<uint32_t, N> generateZobristKeys(uint32_t seed) {
+    std::array<uint32_t, N> keys{};
     for (auto& key : keys) {
         seed = lcg(seed);
         key = seed;
@@ -164,11 +223,50 @@ constexpr std::array<std::pair<int, int>, 32> squareCoords = []{
     return coords;
 }();
 
+// Chebyshev (king-step) distance between every pair of playable squares
+constexpr std::array<std::array<uint8_t, 32>, 32> squareDistance = []{
+    std::array<std::array<uint8_t, 32>, 32> dist{};
+    for (int a = 0; a < 32; a++) {
+        for (int b = 0; b < 32; b++) {
+            int dr = squareCoords[a].first - squareCoords[b].first;
+            int dc = squareCoords[a].second - squareCoords[b].second;
+            dr = dr < 0 ? -dr : dr;
+            dc = dc < 0 ? -dc : dc;
+            dist[a][b] = static_cast<uint8_t>(dr > dc ? dr : dc);
+        }
+    }
+    return dist;
+}();
+
+// distanceRings[sq][d] holds every square at exactly distance d from sq
+constexpr std::array<std::array<Bitboard, 8>, 32> distanceRings = []{
+    std::array<std::array<Bitboard, 8>, 32> rings{};
+    for (int a = 0; a < 32; a++)
+        for (int b = 0; b < 32; b++)
+            rings[a][squareDistance[a][b]] |= 1U << b;
+    return rings;
+}();
+
+// Distance from a square to the nearest piece in targets (targets must be non-empty)
+inline int nearestDistance(uint8_t square, Bitboard targets) noexcept {
+    int dist = 1;
+    while (!(distanceRings[square][dist] & targets) && dist < 7)
+        dist++;
+    return dist;
+}
+
 constexpr std::array<uint32_t, 32> zobrist_white_man = generateZobristKeys(12345);
 constexpr std::array<uint32_t, 32> zobrist_white_king = generateZobristKeys(67890);
 constexpr std::array<uint32_t, 32> zobrist_black_man = generateZobristKeys(54321);
 constexpr std::array<uint32_t, 32> zobrist_black_king = generateZobristKeys(98765);
 constexpr uint32_t zobrist_side_to_move = 0x12345678;
+constexpr auto zobrist_no_progress = generateZobristKeys<NO_PROGRESS_PLIES + 1>(24680);
+
+// A search of any depth can run into the no-progress limit, so the counter is
+// always part of the hash; a fresh counter adds nothing
+inline uint32_t noProgressKey(int quietPlies) noexcept {
+    return quietPlies ? zobrist_no_progress[quietPlies] : 0;
+}
 
 uint32_t computeInitialHash(const GameState& state) {
     uint32_t hash = 0;
@@ -183,9 +281,128 @@ uint32_t computeInitialHash(const GameState& state) {
         }
     }
     if (state.whiteToMove) hash ^= zobrist_side_to_move;
+    return hash ^ noProgressKey(state.quietPlies);
+}
+
+// Colour flip: rotating the board 180 degrees (square s to 31 - s) and
+// swapping colours turns a position with white to move into the same
+// position with black to move. flippedHash is the hash of that twin, kept
+// up to date alongside hash using these tables, indexed by the square in
+// the unflipped position.
+constexpr std::array<uint32_t, 32> flipKeys(const std::array<uint32_t, 32>& keys) {
+    std::array<uint32_t, 32> flipped{};
+    for (int sq = 0; sq < 32; sq++)
+        flipped[sq] = keys[31 - sq];
+    return flipped;
+}
+constexpr std::array<uint32_t, 32> zobrist_flipped_white_man = flipKeys(zobrist_black_man);
+constexpr std::array<uint32_t, 32> zobrist_flipped_white_king = flipKeys(zobrist_black_king);
+constexpr std::array<uint32_t, 32> zobrist_flipped_black_man = flipKeys(zobrist_white_man);
+constexpr std::array<uint32_t, 32> zobrist_flipped_black_king = flipKeys(zobrist_white_king);
+
+uint32_t computeFlippedHash(const GameState& state) {
+    uint32_t hash = 0;
+    for (int pos = 0; pos < 32; pos++) {
+        Bitboard bit = 1U << pos;
+        if (state.white & bit) {
+            if (state.kings & bit) hash ^= zobrist_flipped_white_king[pos];
+            else hash ^= zobrist_flipped_white_man[pos];
+        } else if (state.black & bit) {
+            if (state.kings & bit) hash ^= zobrist_flipped_black_king[pos];
+            else hash ^= zobrist_flipped_black_man[pos];
+        }
+    }
+    if (!state.whiteToMove) hash ^= zobrist_side_to_move;
+    return hash ^ noProgressKey(state.quietPlies);
+}
+
+uint32_t computeMenHash(const GameState& state) {
+    uint32_t hash = 0;
+    Bitboard whiteMen = state.white & ~state.kings;
+    Bitboard blackMen = state.black & ~state.kings;
+    while (whiteMen) {
+        hash ^= zobrist_white_man[std::countr_zero(whiteMen)];
+        whiteMen &= whiteMen - 1;
+    }
+    while (blackMen) {
+        hash ^= zobrist_black_man[std::countr_zero(blackMen)];
+        blackMen &= blackMen - 1;
+    }
     return hash;
 }
 
+// 64-bit position keys for tables kept across runs (opening book, move
+// cache), where the 32-bit search hash would collide too often. Generated
+// with splitmix64 so they do not depend on the search keys.
+constexpr uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// [white man, white king, black man, black king][square], then side to move
+constexpr auto positionKeys = []{
+    std::array<std::array<uint64_t, 32>, 4> keys{};
+    uint64_t state = 0x436865636B657273ULL;  // "Checkers"
+    for (auto& piece : keys)
+        for (auto& key : piece)
+            key = splitmix64(state);
+    return keys;
+}();
+constexpr uint64_t positionKeyWhiteToMove = 0xC3A5C85C97CB3127ULL;
+
+uint64_t computePositionKey(const GameState& state) noexcept {
+    uint64_t key = state.whiteToMove ? positionKeyWhiteToMove : 0;
+    for (Bitboard bb = state.white; bb; bb &= bb - 1) {
+        int sq = std::countr_zero(bb);
+        key ^= positionKeys[(state.kings >> sq) & 1][sq];
+    }
+    for (Bitboard bb = state.black; bb; bb &= bb - 1) {
+        int sq = std::countr_zero(bb);
+        key ^= positionKeys[2 + ((state.kings >> sq) & 1)][sq];
+    }
+    return key;
+}
+
+// With --canonical-hash the caches (transposition table, eval cache, opening
+// book) key a black-to-move position by its white-to-move twin, so the two
+// share one entry. Scores in those caches are from white's point of view in
+// the twin and are negated for the flipped side.
+bool canonicalHashing = false;
+
+constexpr uint8_t flipSquare(uint8_t square) noexcept { return 31 - square; }
+
+constexpr Bitboard flipBitboard(Bitboard bb) noexcept {
+    bb = ((bb >> 1) & 0x55555555U) | ((bb & 0x55555555U) << 1);
+    bb = ((bb >> 2) & 0x33333333U) | ((bb & 0x33333333U) << 2);
+    bb = ((bb >> 4) & 0x0F0F0F0FU) | ((bb & 0x0F0F0F0FU) << 4);
+    bb = ((bb >> 8) & 0x00FF00FFU) | ((bb & 0x00FF00FFU) << 8);
+    return (bb >> 16) | (bb << 16);
+}
+
+// The twin position; hashes are recomputed, the NNUE accumulator is not
+GameState flipColours(const GameState& state) {
+    GameState flipped = state;
+    flipped.white = flipBitboard(state.black);
+    flipped.black = flipBitboard(state.white);
+    flipped.kings = flipBitboard(state.kings);
+    flipped.whiteToMove = !state.whiteToMove;
+    flipped.updateEmpty();
+    flipped.hash = state.flippedHash;
+    flipped.flippedHash = state.hash;
+    flipped.menHash = computeMenHash(flipped);
+    return flipped;
+}
+
+inline bool cacheKeyFlipped(const GameState& state) noexcept {
+    return canonicalHashing && !state.whiteToMove;
+}
+
+inline uint32_t cacheKey(const GameState& state) noexcept {
+    return cacheKeyFlipped(state) ? state.flippedHash : state.hash;
+}
+
 
 // Pre-computed move masks for each square and direction
 struct MoveArrays {
@@ -448,22 +665,238 @@ inline MoveList generateMoves(const GameState& state) noexcept {
     return moveList;
 }
 
+#ifdef CHECKERS_NNUE
+//////////////////////////////////////////////////////////////////////////////
+// NNUE evaluator
+//////////////////////////////////////////////////////////////////////////////
+
+// 128 -> 64 -> 32 -> 1 network scored from white's point of view. The first
+// layer's output (the accumulator) lives in GameState and is updated in
+// applyMove by adding/removing the weight columns of the pieces that changed,
+// so a leaf only pays for the two small dense layers.
+#if defined(__AVX2__)
+#define CHECKERS_NNUE_AVX2
+#elif defined(__SSSE3__)
+#define CHECKERS_NNUE_SSSE3
+#endif
+#if defined(CHECKERS_NNUE_AVX2) || defined(CHECKERS_NNUE_SSSE3)
+#include <immintrin.h>
+#endif
+
+enum NnuePlane : uint8_t { WhiteManPlane, WhiteKingPlane, BlackManPlane, BlackKingPlane };
+
+constexpr uint32_t NNUE_FILE_MAGIC = 0x554E4E43; // "CNNU"
+constexpr uint32_t NNUE_FILE_VERSION = 1;
+constexpr int NNUE_WEIGHT_SHIFT = 6;    // Fixed-point shift of the hidden layers
+constexpr int NNUE_OUTPUT_SCALE = 16;   // Network output units per evaluation point
+
+struct NnueNetwork {
+    alignas(32) std::array<std::array<int16_t, NNUE_HIDDEN1>, NNUE_INPUTS> inputWeights;
+    alignas(32) std::array<int16_t, NNUE_HIDDEN1> inputBias;
+    alignas(32) std::array<std::array<int8_t, NNUE_HIDDEN1>, NNUE_HIDDEN2> hiddenWeights;
+    alignas(32) std::array<int32_t, NNUE_HIDDEN2> hiddenBias;
+    alignas(32) std::array<int8_t, NNUE_HIDDEN2> outputWeights;
+    int32_t outputBias;
+    bool loaded = false;
+};
+
+NnueNetwork nnue;
+
+constexpr int nnueFeature(NnuePlane plane, int square) {
+    return plane * 32 + square;
+}
+
+inline void nnueAddFeature(std::array<int16_t, NNUE_HIDDEN1>& acc, int feature) noexcept {
+    const int16_t* column = nnue.inputWeights[feature].data();
+#if defined(CHECKERS_NNUE_AVX2)
+    for (int i = 0; i < NNUE_HIDDEN1; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(&acc[i]));
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(column + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&acc[i]), _mm256_add_epi16(a, w));
+    }
+#elif defined(CHECKERS_NNUE_SSSE3)
+    for (int i = 0; i < NNUE_HIDDEN1; i += 8) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(&acc[i]));
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(column + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(&acc[i]), _mm_add_epi16(a, w));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN1; i++)
+        acc[i] += column[i];
+#endif
+}
+
+inline void nnueRemoveFeature(std::array<int16_t, NNUE_HIDDEN1>& acc, int feature) noexcept {
+    const int16_t* column = nnue.inputWeights[feature].data();
+#if defined(CHECKERS_NNUE_AVX2)
+    for (int i = 0; i < NNUE_HIDDEN1; i += 16) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(&acc[i]));
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(column + i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&acc[i]), _mm256_sub_epi16(a, w));
+    }
+#elif defined(CHECKERS_NNUE_SSSE3)
+    for (int i = 0; i < NNUE_HIDDEN1; i += 8) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(&acc[i]));
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(column + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(&acc[i]), _mm_sub_epi16(a, w));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN1; i++)
+        acc[i] -= column[i];
+#endif
+}
+
+// Rebuild the accumulator from scratch (after a position is set up directly)
+void nnueRefresh(GameState& state) noexcept {
+    state.accumulator = nnue.inputBias;
+    for (int sq = 0; sq < 32; sq++) {
+        Bitboard bit = 1U << sq;
+        bool king = (state.kings & bit) != 0;
+        if (state.white & bit)
+            nnueAddFeature(state.accumulator, nnueFeature(king ? WhiteKingPlane : WhiteManPlane, sq));
+        else if (state.black & bit)
+            nnueAddFeature(state.accumulator, nnueFeature(king ? BlackKingPlane : BlackManPlane, sq));
+    }
+}
+
+// Clipped ReLU of the accumulator into [0, 127]
+inline void nnueClampAccumulator(const std::array<int16_t, NNUE_HIDDEN1>& acc,
+                                 std::array<uint8_t, NNUE_HIDDEN1>& out) noexcept {
+#if defined(CHECKERS_NNUE_AVX2)
+    const __m256i limit = _mm256_set1_epi8(127);
+    for (int i = 0; i < NNUE_HIDDEN1; i += 32) {
+        __m256i lo = _mm256_load_si256(reinterpret_cast<const __m256i*>(&acc[i]));
+        __m256i hi = _mm256_load_si256(reinterpret_cast<const __m256i*>(&acc[i + 16]));
+        // packus interleaves 128-bit lanes; restore the element order afterwards
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[i]), _mm256_min_epu8(packed, limit));
+    }
+#elif defined(CHECKERS_NNUE_SSSE3)
+    const __m128i limit = _mm_set1_epi8(127);
+    for (int i = 0; i < NNUE_HIDDEN1; i += 16) {
+        __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(&acc[i]));
+        __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(&acc[i + 8]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), _mm_min_epu8(_mm_packus_epi16(lo, hi), limit));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN1; i++)
+        out[i] = static_cast<uint8_t>(std::clamp<int>(acc[i], 0, 127));
+#endif
+}
+
+// Dot product of 64 uint8 activations with 64 int8 weights
+inline int32_t nnueDot64(const uint8_t* input, const int8_t* weights) noexcept {
+#if defined(CHECKERS_NNUE_AVX2)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < NNUE_HIDDEN1; i += 32) {
+        __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+#elif defined(CHECKERS_NNUE_SSSE3)
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < NNUE_HIDDEN1; i += 16) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < NNUE_HIDDEN1; i++)
+        sum += input[i] * weights[i];
+    return sum;
+#endif
+}
+
+// Network score of a position whose accumulator is up to date
+inline int nnueEvaluate(const GameState& state) noexcept {
+    alignas(32) std::array<uint8_t, NNUE_HIDDEN1> hidden1;
+    nnueClampAccumulator(state.accumulator, hidden1);
+
+    alignas(32) std::array<uint8_t, NNUE_HIDDEN2> hidden2;
+    for (int j = 0; j < NNUE_HIDDEN2; j++) {
+        int32_t sum = nnue.hiddenBias[j] + nnueDot64(hidden1.data(), nnue.hiddenWeights[j].data());
+        hidden2[j] = static_cast<uint8_t>(std::clamp(sum >> NNUE_WEIGHT_SHIFT, 0, 127));
+    }
+
+    int32_t output = nnue.outputBias;
+    for (int j = 0; j < NNUE_HIDDEN2; j++)
+        output += hidden2[j] * nnue.outputWeights[j];
+    return output / NNUE_OUTPUT_SCALE;
+}
+
+// Network file: magic, version, the three layer sizes, then each layer's
+// weights followed by its biases, little-endian, in the order of NnueNetwork
+bool loadNnue(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    uint32_t header[5] = {};
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || header[0] != NNUE_FILE_MAGIC || header[1] != NNUE_FILE_VERSION ||
+        header[2] != NNUE_INPUTS || header[3] != NNUE_HIDDEN1 || header[4] != NNUE_HIDDEN2)
+        return false;
+    auto network = std::make_unique<NnueNetwork>();
+    in.read(reinterpret_cast<char*>(network->inputWeights.data()), sizeof(network->inputWeights));
+    in.read(reinterpret_cast<char*>(network->inputBias.data()), sizeof(network->inputBias));
+    in.read(reinterpret_cast<char*>(network->hiddenWeights.data()), sizeof(network->hiddenWeights));
+    in.read(reinterpret_cast<char*>(network->hiddenBias.data()), sizeof(network->hiddenBias));
+    in.read(reinterpret_cast<char*>(network->outputWeights.data()), sizeof(network->outputWeights));
+    in.read(reinterpret_cast<char*>(&network->outputBias), sizeof(network->outputBias));
+    if (!in)
+        return false;
+    network->loaded = true;
+    nnue = *network;
+    return true;
+}
+#endif
+
 // Apply a move to create a new state
 GameState applyMove(const GameState& state, const Move& move) noexcept {
     GameState newState = state;
     Bitboard fromBit = 1U << move.from;
     Bitboard toBit = 1U << move.to;
     
+    bool movingKing = (state.kings & fromBit) != 0;
+    const auto& ourMan = state.whiteToMove ? zobrist_white_man : zobrist_black_man;
+    const auto& ourKing = state.whiteToMove ? zobrist_white_king : zobrist_black_king;
+    const auto& theirMan = state.whiteToMove ? zobrist_black_man : zobrist_white_man;
+    const auto& theirKing = state.whiteToMove ? zobrist_black_king : zobrist_white_king;
+    const auto& ourFlippedMan = state.whiteToMove ? zobrist_flipped_white_man : zobrist_flipped_black_man;
+    const auto& ourFlippedKing = state.whiteToMove ? zobrist_flipped_white_king : zobrist_flipped_black_king;
+    const auto& theirFlippedMan = state.whiteToMove ? zobrist_flipped_black_man : zobrist_flipped_white_man;
+    const auto& theirFlippedKing = state.whiteToMove ? zobrist_flipped_black_king : zobrist_flipped_white_king;
+
      // Update hash for moving piece
-    if (state.whiteToMove) {
-        newState.hash ^= (state.kings & fromBit) ? zobrist_white_king[move.from] : zobrist_white_man[move.from];
+    if (state.whiteToMove)
         newState.white = (newState.white & ~fromBit) | toBit;
-        newState.hash ^= (state.kings & fromBit) ? zobrist_white_king[move.to] : zobrist_white_man[move.to];
-    } else {
-        newState.hash ^= (state.kings & fromBit) ? zobrist_black_king[move.from] : zobrist_black_man[move.from];
+    else
         newState.black = (newState.black & ~fromBit) | toBit;
-        newState.hash ^= (state.kings & fromBit) ? zobrist_black_king[move.to] : zobrist_black_man[move.to];
+    newState.hash ^= movingKing ? (ourKing[move.from] ^ ourKing[move.to]) : (ourMan[move.from] ^ ourMan[move.to]);
+    newState.flippedHash ^= movingKing ? (ourFlippedKing[move.from] ^ ourFlippedKing[move.to])
+                                       : (ourFlippedMan[move.from] ^ ourFlippedMan[move.to]);
+    if (movingKing)
+        newState.kings = (newState.kings & ~fromBit) | toBit;
+    else
+        newState.menHash ^= ourMan[move.from] ^ ourMan[move.to];
+#ifdef CHECKERS_NNUE
+    NnuePlane ourManPlane = state.whiteToMove ? WhiteManPlane : BlackManPlane;
+    NnuePlane ourKingPlane = state.whiteToMove ? WhiteKingPlane : BlackKingPlane;
+    NnuePlane movingPlane = movingKing ? ourKingPlane : ourManPlane;
+    if (nnue.loaded) {
+        nnueRemoveFeature(newState.accumulator, nnueFeature(movingPlane, move.from));
+        nnueAddFeature(newState.accumulator, nnueFeature(movingPlane, move.to));
     }
+#endif
 
     // Handle captures
     if (move.type <= DLCapture) {
@@ -474,6 +907,23 @@ GameState applyMove(const GameState& state, const Move& move) noexcept {
         int midPos = indexFromRC(midRow, midCol);
         if (midPos >= 0) {
             Bitboard midBit = 1U << midPos;
+            if (state.kings & midBit) {
+                newState.hash ^= theirKing[midPos];
+                newState.flippedHash ^= theirFlippedKing[midPos];
+            } else {
+                newState.hash ^= theirMan[midPos];
+                newState.menHash ^= theirMan[midPos];
+                newState.flippedHash ^= theirFlippedMan[midPos];
+            }
+#ifdef CHECKERS_NNUE
+            if (nnue.loaded) {
+                bool capturedKing = (state.kings & midBit) != 0;
+                NnuePlane capturedPlane = state.whiteToMove ?
+                    (capturedKing ? BlackKingPlane : BlackManPlane) :
+                    (capturedKing ? WhiteKingPlane : WhiteManPlane);
+                nnueRemoveFeature(newState.accumulator, nnueFeature(capturedPlane, midPos));
+            }
+#endif
             if (state.whiteToMove)
                 newState.black &= ~midBit;
             else
@@ -486,15 +936,61 @@ GameState applyMove(const GameState& state, const Move& move) noexcept {
         if ((state.whiteToMove && (move.to >= 28)) ||
             (!state.whiteToMove && (move.to <= 3))) {
             newState.kings |= toBit; // Promote to king
+            newState.hash ^= ourMan[move.to] ^ ourKing[move.to];
+            newState.menHash ^= ourMan[move.to];
+            newState.flippedHash ^= ourFlippedMan[move.to] ^ ourFlippedKing[move.to];
+#ifdef CHECKERS_NNUE
+            if (nnue.loaded) {
+                nnueRemoveFeature(newState.accumulator, nnueFeature(ourManPlane, move.to));
+                nnueAddFeature(newState.accumulator, nnueFeature(ourKingPlane, move.to));
+            }
+#endif
         }
     }
     
     newState.updateEmpty();
     newState.whiteToMove = !newState.whiteToMove;
     newState.hash ^=  zobrist_side_to_move;
+    newState.flippedHash ^= zobrist_side_to_move;
+    bool progress = !movingKing || move.type <= DLCapture;
+    newState.quietPlies = progress ? 0 : std::min(state.quietPlies + 1, NO_PROGRESS_PLIES);
+    uint32_t progressKeys = noProgressKey(state.quietPlies) ^ noProgressKey(newState.quietPlies);
+    newState.hash ^= progressKeys;
+    newState.flippedHash ^= progressKeys;
     return newState;
 }
 
+// cacheKey(applyMove(state, move)) without building the position; the
+// updates mirror applyMove's
+inline uint32_t cacheKeyAfter(const GameState& state, const Move& move) noexcept {
+    bool flipped = canonicalHashing && state.whiteToMove;  // The child has black to move
+    bool white = state.whiteToMove;
+    const auto& ourMan = flipped ? (white ? zobrist_flipped_white_man : zobrist_flipped_black_man)
+                                 : (white ? zobrist_white_man : zobrist_black_man);
+    const auto& ourKing = flipped ? (white ? zobrist_flipped_white_king : zobrist_flipped_black_king)
+                                  : (white ? zobrist_white_king : zobrist_black_king);
+    const auto& theirMan = flipped ? (white ? zobrist_flipped_black_man : zobrist_flipped_white_man)
+                                   : (white ? zobrist_black_man : zobrist_white_man);
+    const auto& theirKing = flipped ? (white ? zobrist_flipped_black_king : zobrist_flipped_white_king)
+                                    : (white ? zobrist_black_king : zobrist_white_king);
+    uint32_t key = flipped ? state.flippedHash : state.hash;
+    bool movingKing = (state.kings & (1U << move.from)) != 0;
+    key ^= movingKing ? (ourKing[move.from] ^ ourKing[move.to]) : (ourMan[move.from] ^ ourMan[move.to]);
+    bool capture = move.type <= DLCapture;
+    if (capture) {
+        auto [fromRow, fromCol] = squareCoords[move.from];
+        auto [toRow, toCol] = squareCoords[move.to];
+        int midPos = indexFromRC((fromRow + toRow) >> 1, (fromCol + toCol) >> 1);
+        if (midPos >= 0)
+            key ^= (state.kings & (1U << midPos)) ? theirKing[midPos] : theirMan[midPos];
+    }
+    if (!movingKing && (white ? move.to >= 28 : move.to <= 3))
+        key ^= ourMan[move.to] ^ ourKing[move.to];
+    key ^= zobrist_side_to_move;
+    int quietPlies = (!movingKing || capture) ? 0 : std::min(state.quietPlies + 1, NO_PROGRESS_PLIES);
+    return key ^ noProgressKey(state.quietPlies) ^ noProgressKey(quietPlies);
+}
+
 Bitboard piecesUnderThreat(const GameState& state, bool forWhite) noexcept {
     Bitboard ourPieces = forWhite ? state.white : state.black;
     Bitboard opponentPieces = forWhite ? state.black : state.white;
@@ -657,75 +1153,617 @@ int computeMobility(const GameState& state, bool forWhite) {
     return mobility;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Search statistics
+//////////////////////////////////////////////////////////////////////////////
+
+constexpr int MAX_PLY = 128;
+
+// Counters for one search. Each thread counts into its own thread_local copy
+// (no atomics on the hot path); a multi-threaded search merges them at the end.
+struct SearchStats {
+    uint64_t nodes = 0;
+    uint64_t ttProbes = 0, ttHits = 0, ttCutoffs = 0;
+    uint64_t cutoffs = 0, firstMoveCutoffs = 0;
+    uint64_t aspirationSearches = 0, aspirationFailLows = 0, aspirationFailHighs = 0;
+    uint64_t lmrReductions = 0, lmrReSearches = 0, futilityPrunes = 0, razorPrunes = 0;
+    uint64_t probcutTries = 0, probcutCuts = 0, etcProbes = 0, etcCutoffs = 0;
+    uint64_t extensions = 0, egdbHits = 0, draws = 0;
+    uint64_t evalCacheProbes = 0, evalCacheHits = 0, menCacheProbes = 0, menCacheHits = 0;
+    std::array<uint64_t, MAX_PLY> nodesAtPly{};
+    int depth = 0;
+    double elapsedMs = 0.0;
+
+    void reset() noexcept { *this = SearchStats(); }
+
+    void merge(const SearchStats& other) noexcept {
+        nodes += other.nodes;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+        ttCutoffs += other.ttCutoffs;
+        cutoffs += other.cutoffs;
+        firstMoveCutoffs += other.firstMoveCutoffs;
+        aspirationSearches += other.aspirationSearches;
+        aspirationFailLows += other.aspirationFailLows;
+        aspirationFailHighs += other.aspirationFailHighs;
+        lmrReductions += other.lmrReductions;
+        lmrReSearches += other.lmrReSearches;
+        futilityPrunes += other.futilityPrunes;
+        razorPrunes += other.razorPrunes;
+        probcutTries += other.probcutTries;
+        probcutCuts += other.probcutCuts;
+        etcProbes += other.etcProbes;
+        etcCutoffs += other.etcCutoffs;
+        extensions += other.extensions;
+        egdbHits += other.egdbHits;
+        draws += other.draws;
+        evalCacheProbes += other.evalCacheProbes;
+        evalCacheHits += other.evalCacheHits;
+        menCacheProbes += other.menCacheProbes;
+        menCacheHits += other.menCacheHits;
+        for (int ply = 0; ply < MAX_PLY; ply++)
+            nodesAtPly[ply] += other.nodesAtPly[ply];
+        depth = std::max(depth, other.depth);
+    }
+
+    double nodesPerSecond() const noexcept {
+        return elapsedMs > 0.0 ? nodes * 1000.0 / elapsedMs : 0.0;
+    }
+    double ttHitRate() const noexcept { return ttProbes ? static_cast<double>(ttHits) / ttProbes : 0.0; }
+    double evalCacheHitRate() const noexcept {
+        return evalCacheProbes ? static_cast<double>(evalCacheHits) / evalCacheProbes : 0.0;
+    }
+    double menCacheHitRate() const noexcept {
+        return menCacheProbes ? static_cast<double>(menCacheHits) / menCacheProbes : 0.0;
+    }
+    double firstMoveCutoffRate() const noexcept {
+        return cutoffs ? static_cast<double>(firstMoveCutoffs) / cutoffs : 0.0;
+    }
+    // Effective branching factor over the whole search: nodes^(1/depth)
+    double effectiveBranchingFactor() const noexcept {
+        return depth > 0 ? std::pow(static_cast<double>(nodes), 1.0 / depth) : 0.0;
+    }
+    // Branching factor from ply - 1 to ply
+    double branchingAtPly(int ply) const noexcept {
+        return nodesAtPly[ply - 1] ? static_cast<double>(nodesAtPly[ply]) / nodesAtPly[ply - 1] : 0.0;
+    }
+    int deepestPly() const noexcept {
+        int ply = MAX_PLY - 1;
+        while (ply > 0 && nodesAtPly[ply] == 0) ply--;
+        return ply;
+    }
+};
+
+thread_local SearchStats searchStats;
+
+//////////////////////////////////////////////////////////////////////////////
+// Evaluation weights
+//////////////////////////////////////////////////////////////////////////////
+
+// Every multiplier used by evaluateState. Phase-dependent weights come in
+// _MG/_EG pairs with the endgame value directly after the middlegame one.
+enum EvalParam : uint8_t {
+    MAN_VALUE, KING_VALUE,
+    PST_MG, PST_EG,
+    KING_HOME_PST_PENALTY,          // Endgame king sitting in its own promotion zone (PST)
+    CENTER_MG, CENTER_EG,
+    EDGE_MG, EDGE_EG,
+    KING_HOME_PENALTY,              // Endgame king sitting in its own promotion zone
+    BACK_RANK_MG, BACK_RANK_EG,     // Men still guarding their own back rank
+    BACK_RANK_KING_MG,
+    KING_ADVANCED, KING_ROW_ADVANCE,
+    MOBILITY_MG, MOBILITY_EG,
+    CONNECTION_MG, CONNECTION_EG,
+    THREAT_MG, THREAT_EG,
+    DISTANCE_MG, DISTANCE_EG,
+    NUM_EVAL_PARAMS
+};
+
+constexpr std::array<const char*, NUM_EVAL_PARAMS> evalParamNames = {
+    "MAN_VALUE", "KING_VALUE",
+    "PST_MG", "PST_EG",
+    "KING_HOME_PST_PENALTY",
+    "CENTER_MG", "CENTER_EG",
+    "EDGE_MG", "EDGE_EG",
+    "KING_HOME_PENALTY",
+    "BACK_RANK_MG", "BACK_RANK_EG",
+    "BACK_RANK_KING_MG",
+    "KING_ADVANCED", "KING_ROW_ADVANCE",
+    "MOBILITY_MG", "MOBILITY_EG",
+    "CONNECTION_MG", "CONNECTION_EG",
+    "THREAT_MG", "THREAT_EG",
+    "DISTANCE_MG", "DISTANCE_EG"
+};
+
+using EvalWeights = std::array<int, NUM_EVAL_PARAMS>;
+
+constexpr EvalWeights defaultEvalWeights = {
+    70, 250,    // Material
+    2, 1,       // PST
+    200,        // King home PST penalty
+    10, 2,      // Center
+    5, 1,       // Edge
+    300,        // King home penalty
+    10, 4,      // Back rank men
+    20,         // Back rank kings
+    350, 20,    // King aggression
+    5, 10,      // Mobility
+    10, 7,      // Connections
+    70, 150,    // Threats
+    10, 20      // King distance
+};
+
+#ifdef CHECKERS_BAKED_WEIGHTS
+// Production builds bake the weight set in as a compile-time constant so every
+// multiply in evaluateState is constant-folded. The set comes from
+// baked_weights.h (written by --bake-weights) or falls back to the defaults.
+#if __has_include("baked_weights.h")
+#include "baked_weights.h"
+#else
+constexpr EvalWeights bakedEvalWeights = defaultEvalWeights;
+#endif
+constexpr const EvalWeights& evalWeights = bakedEvalWeights;
+#else
+// Experiment builds read the weights at runtime (--weights <file>)
+EvalWeights evalWeights = defaultEvalWeights;
+#endif
+
+// Weight of a _MG/_EG pair for the current phase
+inline int phaseWeight(const EvalWeights& weights, EvalParam mg, bool isEndgame) noexcept {
+    return weights[mg + isEndgame];
+}
+
+// Weight files hold one "NAME value" pair per line
+bool saveEvalWeights(const std::string& path, const EvalWeights& weights) {
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    for (int i = 0; i < NUM_EVAL_PARAMS; i++)
+        out << evalParamNames[i] << " " << weights[i] << "\n";
+    return static_cast<bool>(out);
+}
+
+// Weights the file does not list keep their current value
+bool loadEvalWeights(const std::string& path, EvalWeights& weights) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    EvalWeights loaded = weights;
+    std::string name;
+    int value;
+    while (in >> name >> value) {
+        auto it = std::find_if(evalParamNames.begin(), evalParamNames.end(),
+                               [&](const char* param) { return name == param; });
+        if (it == evalParamNames.end()) {
+            std::cerr << "Unknown evaluation weight: " << name << std::endl;
+            return false;
+        }
+        loaded[it - evalParamNames.begin()] = value;
+    }
+    if (!in.eof())
+        return false;
+    weights = loaded;
+    return true;
+}
+
+// Write a weight set as the baked_weights.h header used by CHECKERS_BAKED_WEIGHTS
+bool bakeEvalWeights(const std::string& path, const EvalWeights& weights) {
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << "// Generated by CheckersEngine --bake-weights\n";
+    out << "constexpr EvalWeights bakedEvalWeights = {\n";
+    for (int i = 0; i < NUM_EVAL_PARAMS; i++)
+        out << "    " << weights[i] << (i + 1 < NUM_EVAL_PARAMS ? "," : " ") << "  // " << evalParamNames[i] << "\n";
+    out << "};\n";
+    return static_cast<bool>(out);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Pattern tables for men structure
+//////////////////////////////////////////////////////////////////////////////
+
+// Every men-only term of the evaluation (PST, centre/edge control, men kept on
+// their own back rank and men-to-men connections) is folded into lookup tables
+// indexed by the occupancy of a fixed board region. A region is a band of two
+// adjacent rows: each connection lies inside exactly one band, and each square
+// is owned by exactly one band (row r by band r, row 7 by band 6) for its
+// per-square terms. Evaluating the men structure is then one table load per band.
+constexpr int PATTERN_BANDS = 7;
+constexpr int PATTERN_BAND_SQUARES = 8;
+constexpr int PATTERN_BAND_SIZE = 1 << PATTERN_BAND_SQUARES;
+
+constexpr std::array<Bitboard, PATTERN_BANDS> patternBandMasks = []{
+    std::array<Bitboard, PATTERN_BANDS> masks{};
+    for (int band = 0; band < PATTERN_BANDS; band++)
+        masks[band] = 0xFFU << (4 * band);
+    return masks;
+}();
+
+// Gather the bits of bb selected by mask into the low bits of the result
+inline uint32_t extractRegion(Bitboard bb, Bitboard mask) noexcept {
+#ifdef CHECKERS_HAS_PEXT
+    return _pext_u32(bb, mask);
+#else
+    // Contiguous regions (all of the row bands) reduce to a shift
+    int shift = std::countr_zero(mask);
+    Bitboard run = mask >> shift;
+    if ((run & (run + 1)) == 0)
+        return (bb & mask) >> shift;
+    uint32_t index = 0;
+    for (int bit = 0; mask; mask &= mask - 1, bit++) {
+        if (bb & mask & (0 - mask))
+            index |= 1U << bit;
+    }
+    return index;
+#endif
+}
+
+struct PatternTables {
+    // [endgame][band][occupancy], scored from white's point of view
+    std::array<std::array<std::array<int16_t, PATTERN_BAND_SIZE>, PATTERN_BANDS>, 2> white;
+    std::array<std::array<std::array<int16_t, PATTERN_BAND_SIZE>, PATTERN_BANDS>, 2> black;
+};
+
+// Men terms of evaluateState for one band occupancy, for the men of one
+// side and as a positive score
+constexpr int patternScore(const EvalWeights& weights, int endgame, int band, int index, bool black) {
+    int pstMultiplier = weights[PST_MG + endgame];
+    int centerMultiplier = weights[CENTER_MG + endgame];
+    int edgeMultiplier = weights[EDGE_MG + endgame];
+    int backRankMultiplier = weights[BACK_RANK_MG + endgame];
+    int connectionMultiplier = weights[CONNECTION_MG + endgame];
+    Bitboard owned = (band == PATTERN_BANDS - 1) ? patternBandMasks[band] : (0xFU << (4 * band));
+    Bitboard men = static_cast<Bitboard>(index) << (4 * band);
+    int score = 0;
+    for (int sq = 0; sq < 32; sq++) {
+        Bitboard bit = 1U << sq;
+        if (!(men & bit))
+            continue;
+        if (owned & bit) {
+            score += whiteManPST[black ? 31 - sq : sq] * pstMultiplier;
+            if (CENTER_SQUARES & bit)
+                score += centerMultiplier;
+            if (EDGE_SQUARES & bit)
+                score += edgeMultiplier;
+            // Men still guarding their own back rank
+            if ((black ? PROMOTION_ZONE_WHITE : PROMOTION_ZONE_BLACK) & bit)
+                score += backRankMultiplier;
+        }
+        // Connections to the next row up inside this band
+        if (sq < 4 * band + 4) {
+            Bitboard up = moves_array.whiteManLeft[sq] | moves_array.whiteManRight[sq];
+            score += std::popcount(up & men) * connectionMultiplier;
+        }
+    }
+    return score;
+}
+
+// Build the tables from the men terms of evaluateState
+constexpr PatternTables generatePatternTables(const EvalWeights& weights) {
+    PatternTables tables{};
+    for (int endgame = 0; endgame < 2; endgame++) {
+        for (int band = 0; band < PATTERN_BANDS; band++) {
+            for (int index = 0; index < PATTERN_BAND_SIZE; index++) {
+                tables.white[endgame][band][index] = static_cast<int16_t>(patternScore(weights, endgame, band, index, false));
+                tables.black[endgame][band][index] = static_cast<int16_t>(-patternScore(weights, endgame, band, index, true));
+            }
+        }
+    }
+    return tables;
+}
+
+// The tables hold int16 scores, so weights from a file or the tuner are
+// checked before use; an entry out of range would silently wrap
+bool patternTablesFit(const EvalWeights& weights) {
+    for (int endgame = 0; endgame < 2; endgame++)
+        for (int band = 0; band < PATTERN_BANDS; band++)
+            for (int index = 0; index < PATTERN_BAND_SIZE; index++)
+                for (bool black : { false, true }) {
+                    int score = patternScore(weights, endgame, band, index, black);
+                    if (score < -INT16_MAX || score > INT16_MAX)
+                        return false;
+                }
+    return true;
+}
+
+PatternTables patternTables = generatePatternTables(evalWeights);
+
+// Score of the men structure from white's point of view
+inline int evaluatePatterns(Bitboard whiteMen, Bitboard blackMen, bool isEndgame) noexcept {
+    const auto& whiteTable = patternTables.white[isEndgame];
+    const auto& blackTable = patternTables.black[isEndgame];
+    int score = 0;
+    for (int band = 0; band < PATTERN_BANDS; band++) {
+        score += whiteTable[band][extractRegion(whiteMen, patternBandMasks[band])];
+        score += blackTable[band][extractRegion(blackMen, patternBandMasks[band])];
+    }
+    return score;
+}
+
+constexpr uint32_t PATTERN_FILE_MAGIC = 0x54415043; // "CPAT"
+
+// Pattern table file: magic, band count, band size, then the raw int16 tables
+bool savePatternTables(const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+    uint32_t header[3] = { PATTERN_FILE_MAGIC, PATTERN_BANDS, PATTERN_BAND_SIZE };
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&patternTables), sizeof(patternTables));
+    return static_cast<bool>(out);
+}
+
+bool loadPatternTables(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    uint32_t header[3] = {};
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || header[0] != PATTERN_FILE_MAGIC || header[1] != PATTERN_BANDS ||
+        header[2] != PATTERN_BAND_SIZE)
+        return false;
+    PatternTables loaded;
+    in.read(reinterpret_cast<char*>(&loaded), sizeof(loaded));
+    if (!in)
+        return false;
+    patternTables = loaded;
+    return true;
+}
+
+// Lossy cache of exact static evaluations keyed by position hash. Each slot is
+// a single 64-bit word (hash in the high half, score in the low half) written
+// with relaxed atomics, so the cache can be shared between search threads
+// without locks; a torn or overwritten slot simply misses.
+struct EvalCache {
+    std::vector<std::atomic<uint64_t>> table;
+    size_t sizeMask;
+    EvalCache(size_t size) { resize(size); }
+
+    void resize(size_t size) {
+        if (size == 0 || (size & (size - 1)) != 0)
+            throw std::invalid_argument("Size must be a power of two");
+        table = std::vector<std::atomic<uint64_t>>(size);
+        sizeMask = size - 1;
+    }
+
+    inline bool probe(uint32_t hash, int& eval) const noexcept {
+        uint64_t entry = table[hash & sizeMask].load(std::memory_order_relaxed);
+        if (static_cast<uint32_t>(entry >> 32) != hash)
+            return false;
+        eval = static_cast<int32_t>(static_cast<uint32_t>(entry));
+        return true;
+    }
+
+    inline void store(uint32_t hash, int eval) noexcept {
+        uint64_t entry = (static_cast<uint64_t>(hash) << 32) | static_cast<uint32_t>(eval);
+        table[hash & sizeMask].store(entry, std::memory_order_relaxed);
+    }
+};
+
+EvalCache evalCache(1 << 20);  // 1M entries, 8 MB
+EvalCache menCache(1 << 16);   // Men-structure scores keyed by men hash, 512 KB
+
+// Men-structure part of the evaluation. It only changes when a man moves, is
+// captured or promotes, so it is cached by the men-only hash and king moves
+// (most of a long endgame) hit the cache.
+constexpr uint32_t zobrist_endgame_phase = 0x9E3779B9;
+
+inline int evaluateMenStructure(const GameState& state, bool isEndgame) noexcept {
+    uint32_t key = state.menHash ^ (isEndgame ? zobrist_endgame_phase : 0);
+    int score;
+    searchStats.menCacheProbes++;
+    if (menCache.probe(key, score)) {
+        searchStats.menCacheHits++;
+        return score;
+    }
+    score = evaluatePatterns(state.white & ~state.kings, state.black & ~state.kings, isEndgame);
+    menCache.store(key, score);
+    return score;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Evaluation profiler
+//////////////////////////////////////////////////////////////////////////////
+
+// Build with CHECKERS_EVAL_PROFILE defined to record, for every term of
+// evaluateState, the cycles spent computing it and a histogram of the values
+// it contributed. Each thread records into its own profile, merged into the
+// global report when the thread exits; the report is printed at exit.
+#ifdef CHECKERS_EVAL_PROFILE
+#ifndef _MSC_VER
+#include <x86intrin.h>
+#endif
+
+enum EvalTerm : uint8_t {
+    TermMaterial, TermMenStructure, TermKingPst, TermCenter, TermEdge, TermKingHome,
+    TermBackRankKings, TermKingAggression, TermMobility, TermConnections, TermThreats,
+    TermDistance, NUM_EVAL_TERMS
+};
+
+constexpr std::array<const char*, NUM_EVAL_TERMS> evalTermNames = {
+    "material", "men structure", "king PST", "center", "edge", "king home",
+    "back rank kings", "king aggression", "mobility", "connections", "threats",
+    "distance"
+};
+
+// Histogram bucket b holds |value| in [2^(b-1), 2^b); bucket 0 holds zero
+constexpr int EVAL_PROFILE_BUCKETS = 16;
+
+struct EvalProfile {
+    std::array<uint64_t, NUM_EVAL_TERMS> cycles{};
+    std::array<uint64_t, NUM_EVAL_TERMS> samples{};
+    std::array<int64_t, NUM_EVAL_TERMS> sumAbs{};
+    std::array<std::array<uint64_t, EVAL_PROFILE_BUCKETS>, NUM_EVAL_TERMS> histogram{};
+    uint64_t evaluations = 0;
+    std::array<uint64_t, 2> lazyExits{};  // After stage 1, after stage 2
+
+    inline void record(EvalTerm term, int value, uint64_t elapsed) noexcept {
+        unsigned magnitude = static_cast<unsigned>(value < 0 ? -value : value);
+        cycles[term] += elapsed;
+        samples[term]++;
+        sumAbs[term] += magnitude;
+        histogram[term][std::min<int>(std::bit_width(magnitude), EVAL_PROFILE_BUCKETS - 1)]++;
+    }
+
+    void merge(const EvalProfile& other) noexcept {
+        for (int t = 0; t < NUM_EVAL_TERMS; t++) {
+            cycles[t] += other.cycles[t];
+            samples[t] += other.samples[t];
+            sumAbs[t] += other.sumAbs[t];
+            for (int b = 0; b < EVAL_PROFILE_BUCKETS; b++)
+                histogram[t][b] += other.histogram[t][b];
+        }
+        evaluations += other.evaluations;
+        lazyExits[0] += other.lazyExits[0];
+        lazyExits[1] += other.lazyExits[1];
+    }
+
+    void print(std::ostream& os) const {
+        uint64_t totalCycles = 0;
+        for (auto c : cycles) totalCycles += c;
+        os << "Evaluation profile: " << evaluations << " evaluations, lazy exits after stage 1: "
+           << lazyExits[0] << ", after stage 2: " << lazyExits[1] << "\n";
+        os << std::left << std::setw(17) << "term" << std::right << std::setw(14) << "samples"
+           << std::setw(12) << "cycles/call" << std::setw(9) << "cycles%" << std::setw(10) << "mean|v|"
+           << "  |v| histogram (0, 1, 2-3, 4-7, ...)\n";
+        for (int t = 0; t < NUM_EVAL_TERMS; t++) {
+            double n = samples[t] ? static_cast<double>(samples[t]) : 1.0;
+            os << std::left << std::setw(17) << evalTermNames[t] << std::right
+               << std::setw(14) << samples[t]
+               << std::setw(12) << std::fixed << std::setprecision(1) << cycles[t] / n
+               << std::setw(9) << (totalCycles ? 100.0 * cycles[t] / totalCycles : 0.0)
+               << std::setw(10) << sumAbs[t] / n << " ";
+            int last = EVAL_PROFILE_BUCKETS - 1;
+            while (last > 0 && histogram[t][last] == 0) last--;
+            for (int b = 0; b <= last; b++)
+                os << " " << histogram[t][b];
+            os << "\n";
+        }
+        os.unsetf(std::ios::floatfield);
+    }
+};
+
+// Process-wide report, printed when static objects are destroyed at exit
+struct EvalProfileReport {
+    std::mutex mutex;
+    EvalProfile total;
+    ~EvalProfileReport() { total.print(std::cout); }
+};
+
+EvalProfileReport evalProfileReport;
+
+struct ThreadEvalProfile : EvalProfile {
+    ~ThreadEvalProfile() {
+        std::lock_guard<std::mutex> lock(evalProfileReport.mutex);
+        evalProfileReport.total.merge(*this);
+    }
+};
+
+thread_local ThreadEvalProfile evalProfile;
+
+inline uint64_t profileTimestamp() noexcept {
+    return __rdtsc();
+}
+
+// Attribute the cycles since the previous mark to term, along with its value
+#define EVAL_PROFILE_START() uint64_t evalProfileMark = profileTimestamp(); evalProfile.evaluations++
+#define EVAL_PROFILE_TERM(term, value) do { uint64_t now = profileTimestamp(); \
+    evalProfile.record(term, value, now - evalProfileMark); evalProfileMark = now; } while (0)
+#define EVAL_PROFILE_LAZY_EXIT(stage) evalProfile.lazyExits[stage]++
+#else
+#define EVAL_PROFILE_START() ((void)0)
+#define EVAL_PROFILE_TERM(term, value) ((void)0)
+#define EVAL_PROFILE_LAZY_EXIT(stage) ((void)0)
+#endif
+
+// Widen the upside/downside margins by the swing of weight * d for d in [-maxDown, maxUp]
+inline void addTermSwing(int weight, int maxUp, int maxDown, int& upside, int& downside) noexcept {
+    upside += std::max({0, weight * maxUp, -weight * maxDown});
+    downside += std::max({0, -weight * maxUp, weight * maxDown});
+}
+
 // Simple evaluation: piece count weighted by value
 // Enhanced evaluation function
-inline int evaluateState(const GameState& state) noexcept {
+//
+// The terms are computed in three stages ordered by cost. After each stage the
+// largest swing the remaining terms could still produce is bounded from the
+// piece counts; if the partial score plus that swing cannot get back inside
+// (alpha, beta) we stop early and return the bound instead of the exact score.
+// Called with the default full window the result is always exact; otherwise
+// isBound (if given) is set when a bound was returned.
+inline int evaluateState(const GameState& state, int alpha = -INF, int beta = INF,
+                         bool* isBound = nullptr) noexcept {
     // Early game-over checks
     if (state.white == 0) return state.whiteToMove ? -INF : INF;
     if (state.black == 0) return state.whiteToMove ? INF : -INF;
 
+    //////////////////////////////////////////////////////////////////////////
+    // Stage 1: material and popcount/PST terms
+    //////////////////////////////////////////////////////////////////////////
+
+    EVAL_PROFILE_START();
+
     // Material count
     int whiteMen = __builtin_popcount(state.white & ~state.kings);
     int blackMen = __builtin_popcount(state.black & ~state.kings);
     int whiteKings = __builtin_popcount(state.white & state.kings);
     int blackKings = __builtin_popcount(state.black & state.kings);
-    int materialScore = (whiteMen * 70 + whiteKings * 250) -
-                        (blackMen * 70 + blackKings * 250);
+    const EvalWeights& w = evalWeights;
+    int materialScore = (whiteMen * w[MAN_VALUE] + whiteKings * w[KING_VALUE]) -
+                        (blackMen * w[MAN_VALUE] + blackKings * w[KING_VALUE]);
 
     // Detect endgame - when kings are present or few pieces remain
     bool isEndgame = (whiteKings + blackKings > 1) || 
                      (whiteMen + blackMen + whiteKings + blackKings <= 15);
+    EVAL_PROFILE_TERM(TermMaterial, materialScore);
 
-    // PST score - reduce importance in endgame
-    int pstMultiplier = isEndgame ? 1 : 2;
+    // Men structure (PST, centre/edge, back rank, men-to-men connections)
+    int patternScore = evaluateMenStructure(state, isEndgame);
+    EVAL_PROFILE_TERM(TermMenStructure, patternScore);
+
+    // King PST score - reduce importance in endgame
+    int pstMultiplier = phaseWeight(w, PST_MG, isEndgame);
     int pstScore = 0;
-    Bitboard whiteMenBB = state.white & ~state.kings;
+    int kingHomePstPenalty = 0;
     Bitboard whiteKingsBB = state.white & state.kings;
-    Bitboard blackMenBB = state.black & ~state.kings;
     Bitboard blackKingsBB = state.black & state.kings;
 
-    while (whiteMenBB) {
-        uint8_t pos = std::countr_zero(whiteMenBB);
-        pstScore += whiteManPST[pos];
-        whiteMenBB &= whiteMenBB - 1;
-    }
     while (whiteKingsBB) {
         uint8_t pos = std::countr_zero(whiteKingsBB);
         // In endgame, we DISCOURAGE kings from staying in their promotion zone
         if (isEndgame && (pos >= 28 && pos <= 31)) {
-            pstScore -= 200; // Penalty for staying in own promotion zone
+            kingHomePstPenalty -= w[KING_HOME_PST_PENALTY]; // Penalty for staying in own promotion zone
         } else {
             pstScore += kingPST[pos];
         }
         whiteKingsBB &= whiteKingsBB - 1;
     }
-    while (blackMenBB) {
-        uint8_t pos = std::countr_zero(blackMenBB);
-        pstScore -= whiteManPST[31 - pos];  // Mirror for black men
-        blackMenBB &= blackMenBB - 1;
-    }
     while (blackKingsBB) {
         uint8_t pos = std::countr_zero(blackKingsBB);
         // In endgame, we DISCOURAGE kings from staying in their promotion zone
         if (isEndgame && (pos >= 0 && pos <= 8)) {
-            pstScore += 200; // Penalty for black kings staying in own promotion zone
+            kingHomePstPenalty += w[KING_HOME_PST_PENALTY]; // Penalty for black kings staying in own promotion zone
         } else {
             pstScore -= kingPST[pos];  // Same table for black kings
         }
         blackKingsBB &= blackKingsBB - 1;
     }
+    EVAL_PROFILE_TERM(TermKingPst, pstScore * pstMultiplier + kingHomePstPenalty);
 
-    //Center control bonus - less important in endgame
-    int centerMultiplier = isEndgame ? 2 : 10;
-    int whiteCenterControl = __builtin_popcount(state.white & CENTER_SQUARES);
-    int blackCenterControl = __builtin_popcount(state.black & CENTER_SQUARES);
+    //Center control bonus for kings (men are covered by the pattern tables)
+    int centerMultiplier = phaseWeight(w, CENTER_MG, isEndgame);
+    int whiteCenterControl = __builtin_popcount(state.white & state.kings & CENTER_SQUARES);
+    int blackCenterControl = __builtin_popcount(state.black & state.kings & CENTER_SQUARES);
     int centerControlBonus = (whiteCenterControl - blackCenterControl) * centerMultiplier;
+    EVAL_PROFILE_TERM(TermCenter, centerControlBonus);
 
-    //Edge control bonus - less important in endgame
-    int edgeMultiplier = isEndgame ? 1 : 5;
-    int whiteEdgeControl = __builtin_popcount(state.white & EDGE_SQUARES);
-    int blackEdgeControl = __builtin_popcount(state.black & EDGE_SQUARES);
+    //Edge control bonus for kings
+    int edgeMultiplier = phaseWeight(w, EDGE_MG, isEndgame);
+    int whiteEdgeControl = __builtin_popcount(state.white & state.kings & EDGE_SQUARES);
+    int blackEdgeControl = __builtin_popcount(state.black & state.kings & EDGE_SQUARES);
     int edgeControlBonus = (whiteEdgeControl - blackEdgeControl) * edgeMultiplier;
+    EVAL_PROFILE_TERM(TermEdge, edgeControlBonus);
 
     //Promotion zone penalty in endgame for kings
     int promotionZonePenalty = 0;
@@ -736,157 +1774,502 @@ inline int evaluateState(const GameState& state) noexcept {
         int blackKingsInPromoZone = __builtin_popcount((state.black & state.kings) & PROMOTION_ZONE_BLACK);
         
         // Apply severe penalty (negative for white, positive for black)
-        promotionZonePenalty = -300 * whiteKingsInPromoZone + 300 * blackKingsInPromoZone;
+        promotionZonePenalty = -w[KING_HOME_PENALTY] * whiteKingsInPromoZone +
+                               w[KING_HOME_PENALTY] * blackKingsInPromoZone;
     }
+    EVAL_PROFILE_TERM(TermKingHome, promotionZonePenalty);
 
-    //Regular promotion bonus (for men) - reduced in endgame
-    int promotionMultiplier = isEndgame ? 4 : 10;
-    int whitePromotion = __builtin_popcount((state.white & ~state.kings) & PROMOTION_ZONE_BLACK);
-    int blackPromotion = __builtin_popcount((state.black & ~state.kings) & PROMOTION_ZONE_WHITE);
-    int promotionBonus = (whitePromotion - blackPromotion) * promotionMultiplier;
+    // Completely remove back rank bonus in endgame
+    int backRankMultiplier = isEndgame ? 0 : w[BACK_RANK_KING_MG];
+    int whiteBackRankKings = __builtin_popcount(state.white & state.kings & 0xF0000000);  // Squares 28-31
+    int blackBackRankKings = __builtin_popcount(state.black & state.kings & 0x0000000F);  // Squares 0-3
+    int backRankKingBonus = (whiteBackRankKings - blackBackRankKings) * backRankMultiplier;
+    EVAL_PROFILE_TERM(TermBackRankKings, backRankKingBonus);
+
+    // Aggressive king advancement in endgame
+    int kingAggressionBonus = 0;
+    if (isEndgame) {
+        // For white kings - reward being on black's half of the board
+        Bitboard whiteKingsOnBlackSide = state.white & state.kings & 0x00FFFFFF; // Squares 0-23 (black's side)
+        int whiteKingsAdvanced = __builtin_popcount(whiteKingsOnBlackSide);
+        
+        // For black kings - reward being on white's half of the board
+        Bitboard blackKingsOnWhiteSide = state.black & state.kings & 0xFFFFFF00; // Squares 8-31 (white's side)
+        int blackKingsAdvanced = __builtin_popcount(blackKingsOnWhiteSide);
+        
+        // Apply a VERY strong bonus (positive for white, negative for black)
+        kingAggressionBonus = w[KING_ADVANCED] * whiteKingsAdvanced + (-w[KING_ADVANCED] * blackKingsAdvanced);
+        
+        // Additional bonus for kings based on row advancement
+        Bitboard whiteKings = state.white & state.kings;
+        while (whiteKings) {
+            uint8_t kingPos = std::countr_zero(whiteKings);
+            whiteKings &= whiteKings - 1;
+            int row = (kingPos / 4)+1; // 0-7 row index (7 is white's back rank)
+            // Give exponentially more points the closer to black's side
+            kingAggressionBonus += (7 - row) * (7 - row) * w[KING_ROW_ADVANCE];
+        }
+        
+        Bitboard blackKings = state.black & state.kings;
+        while (blackKings) {
+            uint8_t kingPos = std::countr_zero(blackKings);
+            blackKings &= blackKings - 1;
+            int row = (kingPos / 4)+1; // 0-7 row index (0 is black's back rank)
+            // Give exponentially more points the closer to white's side
+            kingAggressionBonus += row * row * w[KING_ROW_ADVANCE];
+        }
+    }
+    EVAL_PROFILE_TERM(TermKingAggression, kingAggressionBonus);
+
+    int totalScore = materialScore + patternScore + centerControlBonus + edgeControlBonus +
+                     (pstScore * pstMultiplier) + kingHomePstPenalty + backRankKingBonus +
+                     kingAggressionBonus + promotionZonePenalty;
+
+    // Largest amount each remaining term can move the score up (towards white)
+    // or down (towards black), bounded from the piece counts alone
+    int mobilityMultiplier = phaseWeight(w, MOBILITY_MG, isEndgame);
+    int connectionMultiplier = phaseWeight(w, CONNECTION_MG, isEndgame);
+    int threatMultiplier = phaseWeight(w, THREAT_MG, isEndgame);
+    int distanceMultiplier = phaseWeight(w, DISTANCE_MG, isEndgame);
+    int whitePieceCount = whiteMen + whiteKings;
+    int blackPieceCount = blackMen + blackKings;
+    int ourPieceCount = state.whiteToMove ? whitePieceCount : blackPieceCount;
+    int theirPieceCount = state.whiteToMove ? blackPieceCount : whitePieceCount;
+    int ourKingCount = state.whiteToMove ? whiteKings : blackKings;
+
+    // Mobility is at most 2 per man and 4 per king, king connections at most 4 per king
+    int stage2Upside = 0, stage2Downside = 0;
+    addTermSwing(mobilityMultiplier, whiteMen * 2 + whiteKings * 4, blackMen * 2 + blackKings * 4,
+                 stage2Upside, stage2Downside);
+    addTermSwing(connectionMultiplier, whiteKings * 4, blackKings * 4, stage2Upside, stage2Downside);
+    // Every piece can be threatened at most once; a king's distance bonus is at most 7 steps
+    int stage3Upside = 0, stage3Downside = 0;
+    addTermSwing(threatMultiplier, theirPieceCount, ourPieceCount, stage3Upside, stage3Downside);
+    addTermSwing(distanceMultiplier, ourKingCount * 7, 0, stage3Upside, stage3Downside);
+
+    if (totalScore + stage2Upside + stage3Upside <= alpha) {
+        EVAL_PROFILE_LAZY_EXIT(0);
+        if (isBound) *isBound = true;
+        return totalScore + stage2Upside + stage3Upside;
+    }
+    if (totalScore - stage2Downside - stage3Downside >= beta) {
+        EVAL_PROFILE_LAZY_EXIT(0);
+        if (isBound) *isBound = true;
+        return totalScore - stage2Downside - stage3Downside;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Stage 2: mobility and connections
+    //////////////////////////////////////////////////////////////////////////
 
 	// Mobility bonus - more important in endgame
-	int mobilityMultiplier = isEndgame ? 10 : 5;
 	int whiteMobility = computeMobility(state, true);
 	int blackMobility = computeMobility(state, false);
 	int mobility = (whiteMobility - blackMobility) * mobilityMultiplier;
+    EVAL_PROFILE_TERM(TermMobility, mobility);
 
-    // Connected pieces bonus - less important in endgame
-    int connectionMultiplier = isEndgame ? 7 : 10;
+    // Connected pieces bonus for connections involving a king (men-to-men
+    // connections come from the pattern tables)
     int whiteConnections = 0;
-    Bitboard whitePieces = state.white;
+    int whiteKingPairs = 0;
+    Bitboard whitePieces = state.white & state.kings;
     while (whitePieces) {
         uint8_t sq = std::countr_zero(whitePieces);
         whitePieces &= whitePieces - 1;
         Bitboard adj = moves_array.whiteManLeft[sq] | moves_array.whiteManRight[sq] |
                        moves_array.blackManLeft[sq] | moves_array.blackManRight[sq];
-        whiteConnections += __builtin_popcount(adj & state.white);
+        whiteConnections += __builtin_popcount(adj & state.white & ~state.kings);
+        whiteKingPairs += __builtin_popcount(adj & state.white & state.kings);
     }
-    whiteConnections /= 2;  // Each connection counted twice
+    whiteConnections += whiteKingPairs / 2;  // King-king connections counted twice
 
     int blackConnections = 0;
-    Bitboard blackPieces = state.black;
+    int blackKingPairs = 0;
+    Bitboard blackPieces = state.black & state.kings;
     while (blackPieces) {
         uint8_t sq = std::countr_zero(blackPieces);
         blackPieces &= blackPieces - 1;
         Bitboard adj = moves_array.whiteManLeft[sq] | moves_array.whiteManRight[sq] |
                        moves_array.blackManLeft[sq] | moves_array.blackManRight[sq];
-        blackConnections += __builtin_popcount(adj & state.black);
+        blackConnections += __builtin_popcount(adj & state.black & ~state.kings);
+        blackKingPairs += __builtin_popcount(adj & state.black & state.kings);
     }
-    blackConnections /= 2;
+    blackConnections += blackKingPairs / 2;
 
     int connectedBonus = (whiteConnections - blackConnections) * connectionMultiplier;
+    EVAL_PROFILE_TERM(TermConnections, connectedBonus);
 
-    // Completely remove back rank bonus in endgame
-    int backRankMultiplier = isEndgame ? 0 : 20;
-    int whiteBackRankKings = __builtin_popcount(state.white & state.kings & 0xF0000000);  // Squares 28-31
-    int blackBackRankKings = __builtin_popcount(state.black & state.kings & 0x0000000F);  // Squares 0-3
-    int backRankKingBonus = (whiteBackRankKings - blackBackRankKings) * backRankMultiplier;
+    totalScore += mobility + connectedBonus;
+
+    if (totalScore + stage3Upside <= alpha) {
+        EVAL_PROFILE_LAZY_EXIT(1);
+        if (isBound) *isBound = true;
+        return totalScore + stage3Upside;
+    }
+    if (totalScore - stage3Downside >= beta) {
+        EVAL_PROFILE_LAZY_EXIT(1);
+        if (isBound) *isBound = true;
+        return totalScore - stage3Downside;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Stage 3: threats and king distance
+    //////////////////////////////////////////////////////////////////////////
 
     // Threat detection - more important in endgame
-    int threatMultiplier = isEndgame ? 150: 70;
     int ourThreatened = __builtin_popcount(piecesUnderThreat(state, state.whiteToMove));
     int theirThreatened = __builtin_popcount(piecesUnderThreat(state, !state.whiteToMove));
     int threatBonus = threatMultiplier * theirThreatened - threatMultiplier * ourThreatened;
+    EVAL_PROFILE_TERM(TermThreats, threatBonus);
 
     // King distance bonus - highly enhanced in endgame
-    int distanceMultiplier = isEndgame ? 20 : 10;
     int distanceBonus = 0;
     
-    if (state.whiteToMove) {
-        Bitboard ourKings = state.white & state.kings;
-        Bitboard theirPieces = state.black;
-        while (ourKings) {
-            uint8_t kingPos = std::countr_zero(ourKings);
-            ourKings &= ourKings - 1;
-            int minDist = 100;
-            Bitboard pieces = theirPieces;
-            while (pieces) {
-                uint8_t piecePos = std::countr_zero(pieces);
-                pieces &= pieces - 1;
-                int dist = std::max(std::abs(squareCoords[kingPos].first - squareCoords[piecePos].first),
-                                    std::abs(squareCoords[kingPos].second - squareCoords[piecePos].second));
-                minDist = std::min(minDist, dist);
-            }
-            distanceBonus += (8 - minDist) * distanceMultiplier;
+    Bitboard ourKings = (state.whiteToMove ? state.white : state.black) & state.kings;
+    Bitboard theirPieces = state.whiteToMove ? state.black : state.white;
+    while (ourKings) {
+        uint8_t kingPos = std::countr_zero(ourKings);
+        ourKings &= ourKings - 1;
+        int minDist = nearestDistance(kingPos, theirPieces);
+        distanceBonus += (8 - minDist) * distanceMultiplier;
+    }
+    EVAL_PROFILE_TERM(TermDistance, distanceBonus);
+
+    // Combine scores with adjusted weights
+    totalScore += threatBonus + distanceBonus;
+                     
+    return  totalScore;
+}
+
+// Feature counts of evaluateState: for any position that is not game over,
+// evaluateState(state) == sum of features[i] * evalWeights[i]. Used by the
+// tuner; keep in step with evaluateState when adding terms.
+using EvalFeatures = std::array<int16_t, NUM_EVAL_PARAMS>;
+
+void extractEvalFeatures(const GameState& state, EvalFeatures& f) noexcept {
+    f.fill(0);
+    Bitboard whiteMenBB = state.white & ~state.kings;
+    Bitboard blackMenBB = state.black & ~state.kings;
+    Bitboard whiteKingsBB = state.white & state.kings;
+    Bitboard blackKingsBB = state.black & state.kings;
+    int whiteMen = std::popcount(whiteMenBB), blackMen = std::popcount(blackMenBB);
+    int whiteKings = std::popcount(whiteKingsBB), blackKings = std::popcount(blackKingsBB);
+    bool isEndgame = (whiteKings + blackKings > 1) ||
+                     (whiteMen + blackMen + whiteKings + blackKings <= 15);
+    int phase = isEndgame ? 1 : 0;
+
+    f[MAN_VALUE] = whiteMen - blackMen;
+    f[KING_VALUE] = whiteKings - blackKings;
+
+    int pst = 0, kingHome = 0;
+    for (Bitboard bb = whiteMenBB; bb; bb &= bb - 1) pst += whiteManPST[std::countr_zero(bb)];
+    for (Bitboard bb = blackMenBB; bb; bb &= bb - 1) pst -= whiteManPST[31 - std::countr_zero(bb)];
+    for (Bitboard bb = whiteKingsBB; bb; bb &= bb - 1) {
+        int pos = std::countr_zero(bb);
+        if (isEndgame && pos >= 28) kingHome--; else pst += kingPST[pos];
+    }
+    for (Bitboard bb = blackKingsBB; bb; bb &= bb - 1) {
+        int pos = std::countr_zero(bb);
+        if (isEndgame && pos <= 8) kingHome++; else pst -= kingPST[pos];
+    }
+    f[PST_MG + phase] = pst;
+    f[KING_HOME_PST_PENALTY] = kingHome;
+
+    f[CENTER_MG + phase] = std::popcount(state.white & CENTER_SQUARES) - std::popcount(state.black & CENTER_SQUARES);
+    f[EDGE_MG + phase] = std::popcount(state.white & EDGE_SQUARES) - std::popcount(state.black & EDGE_SQUARES);
+    f[BACK_RANK_MG + phase] = std::popcount(whiteMenBB & PROMOTION_ZONE_BLACK) -
+                              std::popcount(blackMenBB & PROMOTION_ZONE_WHITE);
+    if (isEndgame) {
+        f[KING_HOME_PENALTY] = std::popcount(blackKingsBB & PROMOTION_ZONE_BLACK) -
+                               std::popcount(whiteKingsBB & PROMOTION_ZONE_WHITE);
+        f[KING_ADVANCED] = std::popcount(whiteKingsBB & 0x00FFFFFF) - std::popcount(blackKingsBB & 0xFFFFFF00);
+        int rowAdvance = 0;
+        for (Bitboard bb = whiteKingsBB; bb; bb &= bb - 1) {
+            int row = std::countr_zero(bb) / 4 + 1;
+            rowAdvance += (7 - row) * (7 - row);
         }
+        for (Bitboard bb = blackKingsBB; bb; bb &= bb - 1) {
+            int row = std::countr_zero(bb) / 4 + 1;
+            rowAdvance += row * row;
+        }
+        f[KING_ROW_ADVANCE] = rowAdvance;
     } else {
-        Bitboard ourKings = state.black & state.kings;
-        Bitboard theirPieces = state.white;
-        while (ourKings) {
-            uint8_t kingPos = std::countr_zero(ourKings);
-            ourKings &= ourKings - 1;
-            int minDist = 100;
-            Bitboard pieces = theirPieces;
-            while (pieces) {
-                uint8_t piecePos = std::countr_zero(pieces);
-                pieces &= pieces - 1;
-                int dist = std::max(std::abs(squareCoords[kingPos].first - squareCoords[piecePos].first),
-                                    std::abs(squareCoords[kingPos].second - squareCoords[piecePos].second));
-                minDist = std::min(minDist, dist);
-            }
-            distanceBonus += (8 - minDist) * distanceMultiplier;
+        f[BACK_RANK_KING_MG] = std::popcount(whiteKingsBB & 0xF0000000) - std::popcount(blackKingsBB & 0x0000000F);
+    }
+
+    f[MOBILITY_MG + phase] = computeMobility(state, true) - computeMobility(state, false);
+
+    auto connections = [](Bitboard pieces) {
+        int links = 0;
+        for (Bitboard bb = pieces; bb; bb &= bb - 1) {
+            int sq = std::countr_zero(bb);
+            Bitboard adj = moves_array.whiteManLeft[sq] | moves_array.whiteManRight[sq] |
+                           moves_array.blackManLeft[sq] | moves_array.blackManRight[sq];
+            links += std::popcount(adj & pieces);
         }
+        return links / 2;
+    };
+    f[CONNECTION_MG + phase] = connections(state.white) - connections(state.black);
+
+    f[THREAT_MG + phase] = std::popcount(piecesUnderThreat(state, !state.whiteToMove)) -
+                           std::popcount(piecesUnderThreat(state, state.whiteToMove));
+
+    int distance = 0;
+    Bitboard ourKings = (state.whiteToMove ? state.white : state.black) & state.kings;
+    Bitboard theirPieces = state.whiteToMove ? state.black : state.white;
+    for (; ourKings; ourKings &= ourKings - 1)
+        distance += 8 - nearestDistance(std::countr_zero(ourKings), theirPieces);
+    f[DISTANCE_MG + phase] = distance;
+}
+
+// The static eval never reads the no-progress counter, so the eval cache is
+// keyed without it and positions reached by different king shuffles share
+// an entry; only the transposition table keeps the counter.
+inline uint32_t evalCacheKey(const GameState& state) noexcept {
+    return cacheKey(state) ^ noProgressKey(state.quietPlies);
+}
+
+// Evaluates a position the cache missed and stores the score if it is exact
+inline int evaluateAndCache(const GameState& state, int alpha, int beta) noexcept {
+    int eval;
+    bool isBound = false;
+#ifdef CHECKERS_NNUE
+    if (nnue.loaded) {
+        if (state.white == 0) return state.whiteToMove ? -INF : INF;
+        if (state.black == 0) return state.whiteToMove ? INF : -INF;
+        eval = nnueEvaluate(state);
+        evalCache.store(evalCacheKey(state), eval);
+        return eval;
     }
+#endif
+    eval = evaluateState(state, alpha, beta, &isBound);
+    if (!isBound)
+        evalCache.store(evalCacheKey(state), eval);
+    return eval;
+}
 
-    // Aggressive king advancement in endgame
-    int kingAggressionBonus = 0;
-    if (isEndgame) {
-        // For white kings - reward being on black's half of the board
-        Bitboard whiteKingsOnBlackSide = state.white & state.kings & 0x00FFFFFF; // Squares 0-23 (black's side)
-        int whiteKingsAdvanced = __builtin_popcount(whiteKingsOnBlackSide);
-        
-        // For black kings - reward being on white's half of the board
-        Bitboard blackKingsOnWhiteSide = state.black & state.kings & 0xFFFFFF00; // Squares 8-31 (white's side)
-        int blackKingsAdvanced = __builtin_popcount(blackKingsOnWhiteSide);
-        
-        // Apply a VERY strong bonus (positive for white, negative for black)
-        kingAggressionBonus = 350* whiteKingsAdvanced + ( -350 * blackKingsAdvanced);
-        
-        // Additional bonus for kings based on row advancement
-        Bitboard whiteKings = state.white & state.kings;
-        while (whiteKings) {
-            uint8_t kingPos = std::countr_zero(whiteKings);
-            whiteKings &= whiteKings - 1;
-            int row = (kingPos / 4)+1; // 0-7 row index (7 is white's back rank)
-            // Give exponentially more points the closer to black's side
-            kingAggressionBonus += (7 - row) * (7 - row) * 20;
+// Static evaluation through the eval cache; only exact scores are cached.
+// With canonical hashing a black-to-move position is evaluated as its twin,
+// so the two share a cache entry and always agree; the twin is only built
+// on a miss.
+inline int evaluateCached(const GameState& state, int alpha, int beta) noexcept {
+    int eval;
+    searchStats.evalCacheProbes++;
+    if (evalCache.probe(evalCacheKey(state), eval)) {
+        searchStats.evalCacheHits++;
+        return cacheKeyFlipped(state) ? -eval : eval;
+    }
+    if (cacheKeyFlipped(state)) {
+        GameState twin = flipColours(state);
+#ifdef CHECKERS_NNUE
+        if (nnue.loaded)
+            nnueRefresh(twin);
+#endif
+        return -evaluateAndCache(twin, -beta, -alpha);
+    }
+    return evaluateAndCache(state, alpha, beta);
+}
+
+// Memory mapping of a whole file, read-only unless opened for writing
+struct MappedFile {
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    bool created = false;  // The file was empty and has just been sized
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    void swap(MappedFile& other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(created, other.created);
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#endif
+    }
+
+    // With writableSize set the mapping is shared read-write; a missing or
+    // empty file is created with writableSize zero bytes, while an existing
+    // one keeps its size and contents for the caller to validate. A
+    // copy-on-write mapping can be modified in memory but never writes back
+    // to the file.
+    bool open(const std::string& path, size_t writableSize = 0, bool copyOnWrite = false) {
+        close();
+        bool writable = writableSize > 0;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                           FILE_SHARE_READ, nullptr, writable ? OPEN_ALWAYS : OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            close();
+            return false;
         }
-        
-        Bitboard blackKings = state.black & state.kings;
-        while (blackKings) {
-            uint8_t kingPos = std::countr_zero(blackKings);
-            blackKings &= blackKings - 1;
-            int row = (kingPos / 4)+1; // 0-7 row index (0 is black's back rank)
-            // Give exponentially more points the closer to white's side
-            kingAggressionBonus += row * row * 20;
+        if (writable && fileSize.QuadPart == 0) {
+            fileSize.QuadPart = static_cast<LONGLONG>(writableSize);
+            if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+                close();
+                return false;
+            }
+            created = true;
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size > 0)
+            mapping = CreateFileMappingA(file, nullptr,
+                                         writable ? PAGE_READWRITE : copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY,
+                                         0, 0, nullptr);
+        if (mapping)
+            data = static_cast<uint8_t*>(MapViewOfFile(
+                mapping, writable ? FILE_MAP_WRITE : copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+#else
+        int fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            size = static_cast<size_t>(info.st_size);
+            if (writable && size == 0 && ftruncate(fd, static_cast<off_t>(writableSize)) == 0) {
+                size = writableSize;
+                created = true;
+            }
+            void* mapped = size > 0 ? mmap(nullptr, size,
+                                           writable || copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ,
+                                           copyOnWrite && !writable ? MAP_PRIVATE : MAP_SHARED, fd, 0)
+                                    : MAP_FAILED;
+            if (mapped != MAP_FAILED)
+                data = static_cast<uint8_t*>(mapped);
+        }
+        ::close(fd);  // The mapping keeps the file alive
+#endif
+        if (!data) {
+            close();
+            return false;
         }
+        return true;
     }
 
-    // Combine scores with adjusted weights
-    int totalScore = materialScore + centerControlBonus + edgeControlBonus + promotionBonus + 
-                     (pstScore * pstMultiplier) + mobility + connectedBonus + backRankKingBonus + 
-                     threatBonus + distanceBonus + kingAggressionBonus + promotionZonePenalty;
-                     
-    return  totalScore;
+    void close() {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data)
+            munmap(data, size);
+#endif
+        data = nullptr;
+        size = 0;
+        created = false;
+    }
+};
+
+// Transposition table snapshots are the raw entry array behind a header.
+// Entries are only meaningful under the Zobrist keys, Entry layout and key
+// mode (--canonical-hash) that wrote them, so all three are recorded and
+// checked on load:
+//   header   TTSnapshotHeader
+//   entries  TranspositionTable::Entry[entries]
+// A loaded snapshot is mapped copy-on-write, so searching on top of it never
+// modifies the file and only the pages actually touched are read in.
+constexpr uint32_t TT_SNAPSHOT_MAGIC = 0x53545443; // "CTTS"
+constexpr uint32_t TT_SNAPSHOT_VERSION = 3;
+constexpr uint32_t TT_SNAPSHOT_CANONICAL = 1;  // TTSnapshotHeader flag: keyed by cacheKey
+
+struct TTSnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t zobristChecksum;
+    uint64_t entryLayout;  // Field offsets and sizes, one byte each
+    uint32_t entrySize;
+    uint32_t flags;
+    uint32_t generation;   // Of the last search, so entries keep their age
+    uint32_t reserved;
+    uint64_t entries;
+};
+
+// Folds every search key into one value
+uint64_t zobristChecksum() {
+    uint64_t checksum = 0;
+    auto mix = [&](uint32_t key) {
+        uint64_t state = checksum ^ key;
+        checksum = splitmix64(state);
+    };
+    for (const auto* keys : { &zobrist_white_man, &zobrist_white_king, &zobrist_black_man, &zobrist_black_king })
+        for (uint32_t key : *keys)
+            mix(key);
+    for (uint32_t key : zobrist_no_progress)
+        mix(key);
+    mix(zobrist_side_to_move);
+    mix(NO_PROGRESS_PLIES);
+    return checksum;
 }
 
 // Transposition table for alpha-beta search
 struct TranspositionTable {
-    enum Flag { EXACT, LOWER, UPPER };
+    enum Flag : uint8_t { EXACT, LOWER, UPPER };
     struct Entry {
         uint32_t hash;
-        int16_t eval;
+        int32_t eval;  // Mate scores (±INF) do not fit in 16 bits
+        uint16_t generation;  // Search that stored it
         uint8_t depth;
         Flag flag;
     };
+    static_assert(sizeof(Entry) == 12, "TranspositionTable::Entry should pack into 12 bytes");
     
-    std::vector<Entry> table;
-    size_t sizeMask;
-    TranspositionTable(size_t size) : table(size), sizeMask(size - 1) {
-        if ((size & sizeMask) != 0)
+    Entry* table = nullptr;  // Points into storage or the snapshot mapping
+    size_t sizeMask = 0;
+    uint16_t generation = 0;
+    std::vector<Entry> storage;
+    MappedFile snapshot;
+
+    TranspositionTable() = default;
+    TranspositionTable(size_t size) { resize(size); }
+
+    void resize(size_t size) {
+        if (size == 0 || (size & (size - 1)) != 0)
             throw std::invalid_argument("Size must be a power of two");
+        snapshot.close();
+        storage.assign(size, Entry{});
+        table = storage.data();
+        sizeMask = size - 1;
+        generation = 0;
+    }
+
+    size_t size() const noexcept { return table ? sizeMask + 1 : 0; }
+
+    inline void prefetch(uint32_t hash) const noexcept {
+#ifdef _MSC_VER
+        _mm_prefetch(reinterpret_cast<const char*>(&table[hash & sizeMask]), _MM_HINT_T0);
+#else
+        __builtin_prefetch(&table[hash & sizeMask]);
+#endif
     }
+
+    static uint64_t entryLayout() noexcept {
+        return static_cast<uint64_t>(offsetof(Entry, eval) | offsetof(Entry, depth) << 8 |
+                                     offsetof(Entry, generation) << 16 | offsetof(Entry, flag) << 24) |
+               static_cast<uint64_t>(sizeof(Flag)) << 32 | static_cast<uint64_t>(sizeof(Entry::generation)) << 40;
+    }
+
+    // The table outlives a single search, so entries left by earlier searches
+    // give way to new ones whatever their depth. The counter wraps after
+    // 65536 searches; an entry that old merely looks current again and falls
+    // back to depth-preferred replacement.
+    void newSearch() noexcept { generation++; }
     
     inline bool lookup(uint32_t hash, int depth, int& eval, Flag& flag) noexcept {
         Entry& entry = table[hash & sizeMask];
@@ -900,52 +2283,1231 @@ struct TranspositionTable {
     
     inline void store(uint32_t hash, int depth, int eval, Flag flag) noexcept {
         Entry& entry = table[hash & sizeMask];
-        if (depth >= entry.depth) {
+        if (depth >= entry.depth || entry.generation != generation) {
             entry.hash = hash;
             entry.depth = depth;
+            entry.generation = generation;
             entry.eval = eval;
             entry.flag = flag;
         }
     }
+
+    // Keyed by cacheKey; under a flipped key the stored score is the twin's
+    static constexpr Flag flipFlag(Flag flag) noexcept {
+        return flag == LOWER ? UPPER : flag == UPPER ? LOWER : EXACT;
+    }
+
+    inline bool lookup(uint32_t key, bool flipped, int depth, int& eval, Flag& flag) noexcept {
+        if (!lookup(key, depth, eval, flag))
+            return false;
+        if (flipped) {
+            eval = -eval;
+            flag = flipFlag(flag);
+        }
+        return true;
+    }
+
+    inline bool lookup(const GameState& state, int depth, int& eval, Flag& flag) noexcept {
+        return lookup(cacheKey(state), cacheKeyFlipped(state), depth, eval, flag);
+    }
+
+    inline void store(const GameState& state, int depth, int eval, Flag flag) noexcept {
+        if (cacheKeyFlipped(state))
+            store(state.flippedHash, depth, -eval, flipFlag(flag));
+        else
+            store(state.hash, depth, eval, flag);
+    }
+
+    // Written to a temporary file and renamed into place, so a table running
+    // from a snapshot can be saved back over the file it was loaded from
+    bool save(const std::string& path) const {
+        if (!table)
+            return false;
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            if (!out)
+                return false;
+            TTSnapshotHeader header = { TT_SNAPSHOT_MAGIC, TT_SNAPSHOT_VERSION, zobristChecksum(),
+                                        entryLayout(), sizeof(Entry),
+                                        canonicalHashing ? TT_SNAPSHOT_CANONICAL : 0, generation, 0, size() };
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(table), size() * sizeof(Entry));
+            if (!out) {
+                out.close();
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        std::remove(path.c_str());  // rename() does not replace on Windows
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+    // The table takes the snapshot's size; on failure it is left unchanged
+    bool load(const std::string& path) {
+        MappedFile file;
+        if (!file.open(path, 0, true))
+            return false;
+        TTSnapshotHeader header;
+        if (file.size < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data, sizeof(header));
+        if (header.magic != TT_SNAPSHOT_MAGIC || header.version != TT_SNAPSHOT_VERSION) {
+            std::cerr << "Not a transposition table snapshot: " << path << std::endl;
+            return false;
+        }
+        if (header.zobristChecksum != zobristChecksum() || header.entrySize != sizeof(Entry) ||
+            header.entryLayout != entryLayout()) {
+            std::cerr << "Transposition table snapshot " << path
+                      << " was written by an incompatible build" << std::endl;
+            return false;
+        }
+        if (((header.flags & TT_SNAPSHOT_CANONICAL) != 0) != canonicalHashing) {
+            std::cerr << "Transposition table snapshot " << path << " was saved "
+                      << (canonicalHashing ? "without" : "with") << " --canonical-hash" << std::endl;
+            return false;
+        }
+        if (header.entries == 0 || (header.entries & (header.entries - 1)) ||
+            file.size < sizeof(header) + header.entries * sizeof(Entry)) {
+            std::cerr << "Transposition table snapshot " << path << " is truncated" << std::endl;
+            return false;
+        }
+        storage = {};
+        snapshot.swap(file);
+        table = reinterpret_cast<Entry*>(snapshot.data + sizeof(header));
+        sizeMask = header.entries - 1;
+        generation = static_cast<uint16_t>(header.generation);
+        return true;
+    }
+};
+
+// Shared by findBestMove and analysis, so it stays warm between searches and
+// can be saved and reloaded (--tt-save, --tt-load). Allocated on first use
+// unless a snapshot or --tt-size came first.
+constexpr size_t DEFAULT_TT_ENTRIES = 1 << 25;
+TranspositionTable transpositionTable;
+
+void printGameState(const GameState& state) {
+    std::cout << "  0 1 2 3 4 5 6 7\n";
+    for (int row = 0; row < 8; row++) {
+        std::cout << row << " ";
+        for (int col = 0; col < 8; col++) {
+            if ((row + col) % 2 == 0)
+                std::cout << "  ";
+            else {
+                int idx = indexFromRC(row, col);
+                char cell = '.';
+                if (state.white & (1U << idx))
+                    cell = (state.kings & (1U << idx)) ? 'W' : 'w';
+                else if (state.black & (1U << idx))
+                    cell = (state.kings & (1U << idx)) ? 'B' : 'b';
+                std::cout << cell << " ";
+            }
+        }
+        std::cout << "\n";
+    }
+    std::cout << (state.whiteToMove ? "White" : "Black") << " to move\n";
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Endgame databases
+//////////////////////////////////////////////////////////////////////////////
+
+// Win/draw/loss tables for every position with few pieces, built offline by
+// retrograde analysis (--build-egdb) and probed from minimax (--egdb).
+// Positions are grouped into slices by material, and numbered inside a slice
+// combinatorially:
+//   white men   as a combination of the 28 squares a white man can stand on,
+//   black men   likewise over theirs (overlapping placements are left unused),
+//   white kings over the squares the men leave free,
+//   black kings over the squares left after that,
+// with white to move in the upper half. Values are relative to the side to
+// move; see EgdbFileHeader for the file format.
+
+constexpr int EGDB_MAX_PIECES = 8;
+constexpr int EGDB_MEN_SQUARES = 28;
+constexpr Bitboard WHITE_MEN_SQUARES = ~PROMOTION_ZONE_WHITE;
+constexpr Bitboard BLACK_MEN_SQUARES = ~PROMOTION_ZONE_BLACK;
+constexpr uint32_t EGDB_FILE_MAGIC = 0x4C445743; // "CWDL"
+constexpr int EGDB_WIN_SCORE = INF / 2;          // Plus the static eval, to steer towards progress
+
+enum EgdbValue : uint8_t { EGDB_DRAW = 0, EGDB_WIN = 1, EGDB_LOSS = 2, EGDB_INVALID = 3 };
+
+constexpr auto binomial = []{
+    std::array<std::array<uint64_t, EGDB_MAX_PIECES + 1>, 33> c{};
+    for (int n = 0; n <= 32; n++) {
+        c[n][0] = 1;
+        for (int k = 1; k <= EGDB_MAX_PIECES && k <= n; k++)
+            c[n][k] = c[n - 1][k - 1] + c[n - 1][k];
+    }
+    return c;
+}();
+
+// Colex rank of a set of squares: sum of C(square, i) over the i-th lowest
+inline uint64_t rankCombination(Bitboard set) noexcept {
+    uint64_t rank = 0;
+    for (int i = 1; set; set &= set - 1, i++)
+        rank += binomial[std::countr_zero(set)][i];
+    return rank;
+}
+
+// Inverse of rankCombination for a k-subset of [0, n)
+inline Bitboard unrankCombination(uint64_t rank, int k, int n) noexcept {
+    Bitboard set = 0;
+    for (int i = k; i >= 1; i--) {
+        int c = i - 1;
+        while (c + 1 < n && binomial[c + 1][i] <= rank)
+            c++;
+        rank -= binomial[c][i];
+        set |= 1U << c;
+        n = c;
+    }
+    return set;
+}
+
+// Inverse of extractRegion: spread the low bits of index over mask
+inline Bitboard depositRegion(uint32_t index, Bitboard mask) noexcept {
+#ifdef CHECKERS_HAS_PEXT
+    return _pdep_u32(index, mask);
+#else
+    Bitboard bb = 0;
+    for (int bit = 0; mask; mask &= mask - 1, bit++) {
+        if (index & (1U << bit))
+            bb |= mask & (0 - mask);
+    }
+    return bb;
+#endif
+}
+
+struct EgdbMaterial {
+    int whiteMen = 0, whiteKings = 0, blackMen = 0, blackKings = 0;
+
+    static EgdbMaterial of(const GameState& state) noexcept {
+        return { std::popcount(state.white & ~state.kings), std::popcount(state.white & state.kings),
+                 std::popcount(state.black & ~state.kings), std::popcount(state.black & state.kings) };
+    }
+    int pieces() const noexcept { return whiteMen + whiteKings + blackMen + blackKings; }
+    uint32_t key() const noexcept {
+        return whiteMen | (whiteKings << 4) | (blackMen << 8) | (blackKings << 12);
+    }
+    // Positions in the slice, unused indices included
+    uint64_t size() const noexcept {
+        int free = 32 - whiteMen - blackMen;
+        return binomial[EGDB_MEN_SQUARES][whiteMen] * binomial[EGDB_MEN_SQUARES][blackMen] *
+               binomial[free][whiteKings] * binomial[free - whiteKings][blackKings] * 2;
+    }
+    std::string name() const {
+        return std::to_string(whiteMen) + std::to_string(whiteKings) + "v" +
+               std::to_string(blackMen) + std::to_string(blackKings);
+    }
+};
+
+// Position -> index within its material slice
+inline uint64_t egdbIndex(const GameState& state, const EgdbMaterial& m) noexcept {
+    Bitboard whiteMen = state.white & ~state.kings, blackMen = state.black & ~state.kings;
+    Bitboard whiteKings = state.white & state.kings, blackKings = state.black & state.kings;
+    Bitboard free = ~(whiteMen | blackMen);
+    int freeCount = 32 - m.whiteMen - m.blackMen;
+    uint64_t index = rankCombination(extractRegion(whiteMen, WHITE_MEN_SQUARES));
+    index = index * binomial[EGDB_MEN_SQUARES][m.blackMen] +
+            rankCombination(extractRegion(blackMen, BLACK_MEN_SQUARES));
+    index = index * binomial[freeCount][m.whiteKings] + rankCombination(extractRegion(whiteKings, free));
+    index = index * binomial[freeCount - m.whiteKings][m.blackKings] +
+            rankCombination(extractRegion(blackKings, free & ~whiteKings));
+    return (state.whiteToMove ? m.size() / 2 : 0) + index;
+}
+
+// Index -> position; false for the unused indices where men overlap
+inline bool egdbPosition(uint64_t index, const EgdbMaterial& m, GameState& state) noexcept {
+    int freeCount = 32 - m.whiteMen - m.blackMen;
+    uint64_t half = m.size() / 2;
+    state.whiteToMove = index >= half;
+    index %= half;
+    uint64_t blackKingCount = binomial[freeCount - m.whiteKings][m.blackKings];
+    uint64_t blackKingRank = index % blackKingCount;
+    index /= blackKingCount;
+    uint64_t whiteKingCount = binomial[freeCount][m.whiteKings];
+    uint64_t whiteKingRank = index % whiteKingCount;
+    index /= whiteKingCount;
+    uint64_t blackMenCount = binomial[EGDB_MEN_SQUARES][m.blackMen];
+    Bitboard blackMen = depositRegion(unrankCombination(index % blackMenCount, m.blackMen, EGDB_MEN_SQUARES),
+                                      BLACK_MEN_SQUARES);
+    Bitboard whiteMen = depositRegion(unrankCombination(index / blackMenCount, m.whiteMen, EGDB_MEN_SQUARES),
+                                      WHITE_MEN_SQUARES);
+    if (whiteMen & blackMen)
+        return false;
+    Bitboard free = ~(whiteMen | blackMen);
+    Bitboard whiteKings = depositRegion(unrankCombination(whiteKingRank, m.whiteKings, freeCount), free);
+    Bitboard blackKings = depositRegion(unrankCombination(blackKingRank, m.blackKings,
+                                                          freeCount - m.whiteKings), free & ~whiteKings);
+    state.white = whiteMen | whiteKings;
+    state.black = blackMen | blackKings;
+    state.kings = whiteKings | blackKings;
+    state.updateEmpty();
+    state.hash = computeInitialHash(state);
+    state.menHash = computeMenHash(state);
+    state.flippedHash = computeFlippedHash(state);
+    return true;
+}
+
+// A table during generation: the whole slice unpacked in memory
+struct EgdbSlice {
+    EgdbMaterial material;
+    std::vector<uint8_t> values;  // Four 2-bit EgdbValues per byte
+
+    inline EgdbValue get(uint64_t index) const noexcept {
+        return static_cast<EgdbValue>((values[index >> 2] >> ((index & 3) * 2)) & 3);
+    }
+};
+
+// Finished slices the generator looks successors up in
+struct EgdbSliceSet {
+    std::vector<EgdbSlice> slices;
+    std::vector<int32_t> sliceByKey = std::vector<int32_t>(1 << 16, -1);
+
+    void add(EgdbSlice slice) {
+        sliceByKey[slice.material.key()] = static_cast<int32_t>(slices.size());
+        slices.push_back(std::move(slice));
+    }
+    const EgdbSlice* find(const EgdbMaterial& m) const noexcept {
+        int32_t i = sliceByKey[m.key()];
+        return i < 0 ? nullptr : &slices[i];
+    }
+};
+
+// On disk a slice is cut into blocks of EGDB_BLOCK_POSITIONS positions, each
+// stored either packed (four values a byte) or run-length coded, whichever
+// is smaller:
+//   header   EgdbFileHeader
+//   offsets  uint64_t[blocks + 1], block starts relative to the first block
+//   blocks   one encoding byte (EgdbBlockEncoding), then the payload
+// A run is one byte, value | length << 2, with length 0 meaning the length
+// follows as a LEB128 varint. The side to move is the top bit of the index,
+// so runs are not broken up by alternating colours.
+constexpr uint32_t EGDB_FILE_VERSION = 2;
+constexpr uint32_t EGDB_BLOCK_POSITIONS = 1 << 16;
+
+enum EgdbBlockEncoding : uint8_t { EGDB_BLOCK_PACKED = 0, EGDB_BLOCK_RUNS = 1 };
+
+struct EgdbFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t materialKey;
+    uint32_t blockPositions;
+    uint64_t positions;
+    uint64_t blocks;
+};
+
+std::vector<uint8_t> encodeEgdbBlock(const EgdbSlice& slice, uint64_t first, uint64_t count) {
+    std::vector<uint8_t> runs = { EGDB_BLOCK_RUNS };
+    for (uint64_t i = 0; i < count;) {
+        EgdbValue value = slice.get(first + i);
+        uint64_t length = 1;
+        while (i + length < count && slice.get(first + i + length) == value)
+            length++;
+        i += length;
+        if (length < 64) {
+            runs.push_back(static_cast<uint8_t>(value | (length << 2)));
+        } else {
+            runs.push_back(value);
+            for (; length >= 0x80; length >>= 7)
+                runs.push_back(static_cast<uint8_t>(length | 0x80));
+            runs.push_back(static_cast<uint8_t>(length));
+        }
+    }
+    size_t packedBytes = (count + 3) / 4;
+    if (runs.size() <= packedBytes + 1)
+        return runs;
+    // first is a multiple of the block size, so the packed bytes copy straight
+    std::vector<uint8_t> packed = { EGDB_BLOCK_PACKED };
+    packed.insert(packed.end(), slice.values.begin() + first / 4, slice.values.begin() + first / 4 + packedBytes);
+    return packed;
+}
+
+bool saveEgdbSlice(const std::string& path, const EgdbSlice& slice) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+    uint64_t positions = slice.material.size();
+    EgdbFileHeader header = { EGDB_FILE_MAGIC, EGDB_FILE_VERSION, slice.material.key(),
+                              EGDB_BLOCK_POSITIONS, positions,
+                              (positions + EGDB_BLOCK_POSITIONS - 1) / EGDB_BLOCK_POSITIONS };
+    std::vector<uint64_t> offsets = { 0 };
+    std::vector<uint8_t> data;
+    for (uint64_t block = 0; block < header.blocks; block++) {
+        uint64_t first = block * EGDB_BLOCK_POSITIONS;
+        std::vector<uint8_t> encoded =
+            encodeEgdbBlock(slice, first, std::min<uint64_t>(EGDB_BLOCK_POSITIONS, positions - first));
+        data.insert(data.end(), encoded.begin(), encoded.end());
+        offsets.push_back(data.size());
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(out);
+}
+
+// A mapped table file; blocks are decoded on demand
+struct EgdbFile {
+    EgdbMaterial material;
+    MappedFile file;
+    EgdbFileHeader header{};
+    const uint64_t* offsets = nullptr;
+    const uint8_t* blocks = nullptr;
+
+    bool open(const std::string& path, const EgdbMaterial& m) {
+        if (!file.open(path) || file.size < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data, sizeof(header));
+        if (header.magic != EGDB_FILE_MAGIC || header.version != EGDB_FILE_VERSION ||
+            header.materialKey != m.key() || header.positions != m.size() || header.blockPositions == 0 ||
+            header.blocks != (header.positions + header.blockPositions - 1) / header.blockPositions)
+            return false;
+        size_t indexBytes = sizeof(header) + (header.blocks + 1) * sizeof(uint64_t);
+        if (file.size < indexBytes)
+            return false;
+        material = m;
+        offsets = reinterpret_cast<const uint64_t*>(file.data + sizeof(header));
+        blocks = file.data + indexBytes;
+        return offsets[header.blocks] == file.size - indexBytes;
+    }
+
+    // Unpack one block to four values a byte
+    std::vector<uint8_t> decodeBlock(uint64_t block) const {
+        uint64_t count = std::min<uint64_t>(header.blockPositions, header.positions - block * header.blockPositions);
+        std::vector<uint8_t> values((count + 3) / 4, 0);
+        const uint8_t* p = blocks + offsets[block];
+        const uint8_t* end = blocks + offsets[block + 1];
+        if (*p++ == EGDB_BLOCK_PACKED) {
+            std::copy(p, std::min(end, p + values.size()), values.begin());
+            return values;
+        }
+        for (uint64_t i = 0; p < end && i < count;) {
+            uint8_t value = *p & 3;
+            uint64_t length = *p++ >> 2;
+            if (length == 0) {
+                for (int shift = 0; p < end; shift += 7) {
+                    length |= static_cast<uint64_t>(*p & 0x7F) << shift;
+                    if (!(*p++ & 0x80))
+                        break;
+                }
+            }
+            for (uint64_t stop = std::min(count, i + length); i < stop; i++)
+                values[i >> 2] |= value << ((i & 3) * 2);
+        }
+        return values;
+    }
+};
+
+// Decoded blocks shared by all tables, least recently used evicted first.
+// Each thread also remembers the last block it probed, which is usually the
+// next one it needs, so most probes skip the lock entirely.
+struct EgdbBlockCache {
+    using Block = std::shared_ptr<const std::vector<uint8_t>>;
+
+    size_t capacity = 4096;  // Blocks of EGDB_BLOCK_POSITIONS / 4 bytes (64 MB)
+    std::list<std::pair<uint64_t, Block>> recent;  // Most recent first
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Block>>::iterator> blocks;
+    std::mutex mutex;
+    std::atomic<uint64_t> probes{0}, hits{0};
+
+    template <typename Decode>
+    Block get(uint64_t key, Decode decode) {
+        probes.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = blocks.find(key);
+            if (it != blocks.end()) {
+                hits.fetch_add(1, std::memory_order_relaxed);
+                recent.splice(recent.begin(), recent, it->second);
+                return it->second->second;
+            }
+        }
+        // Decode outside the lock; a racing thread may decode the same block
+        Block block = std::make_shared<const std::vector<uint8_t>>(decode());
+        std::lock_guard<std::mutex> lock(mutex);
+        if (blocks.count(key))
+            return block;
+        recent.emplace_front(key, block);
+        blocks[key] = recent.begin();
+        while (blocks.size() > std::max<size_t>(capacity, 1)) {
+            blocks.erase(recent.back().first);
+            recent.pop_back();
+        }
+        return block;
+    }
+
+    double hitRate() const noexcept {
+        uint64_t p = probes.load(std::memory_order_relaxed);
+        return p ? static_cast<double>(hits.load(std::memory_order_relaxed)) / p : 0.0;
+    }
+    void resetStats() noexcept {
+        probes.store(0, std::memory_order_relaxed);
+        hits.store(0, std::memory_order_relaxed);
+    }
+};
+
+struct EgdbLastBlock {
+    uint64_t key = ~0ULL;
+    EgdbBlockCache::Block block;
+};
+
+thread_local EgdbLastBlock egdbLastBlock;
+
+struct EndgameDatabase {
+    std::vector<std::unique_ptr<EgdbFile>> files;
+    std::vector<int32_t> fileByKey = std::vector<int32_t>(1 << 16, -1);
+    EgdbBlockCache cache;
+    int maxPieces = 0;  // Probing starts at this many pieces or fewer
+
+    void add(std::unique_ptr<EgdbFile> file) {
+        fileByKey[file->material.key()] = static_cast<int32_t>(files.size());
+        files.push_back(std::move(file));
+    }
+    bool has(const EgdbMaterial& m) const noexcept { return fileByKey[m.key()] >= 0; }
+
+    // Value for the side to move; false if no table covers the position
+    inline bool probe(const GameState& state, EgdbValue& value) {
+        if (std::popcount(state.white | state.black) > maxPieces)
+            return false;
+        EgdbMaterial m = EgdbMaterial::of(state);
+        int32_t fileIndex = fileByKey[m.key()];
+        if (fileIndex < 0)
+            return false;
+        const EgdbFile& file = *files[fileIndex];
+        uint64_t index = egdbIndex(state, m);
+        uint64_t block = index / file.header.blockPositions;
+        uint64_t offset = index % file.header.blockPositions;
+        uint64_t key = (static_cast<uint64_t>(fileIndex) << 40) | block;
+        if (egdbLastBlock.key != key) {
+            egdbLastBlock.block = cache.get(key, [&] { return file.decodeBlock(block); });
+            egdbLastBlock.key = key;
+        }
+        value = static_cast<EgdbValue>(((*egdbLastBlock.block)[offset >> 2] >> ((offset & 3) * 2)) & 3);
+        return true;
+    }
+};
+
+EndgameDatabase egdb;
+
+std::string egdbFileName(const std::string& dir, const EgdbMaterial& m) {
+    return dir + "/" + m.name() + ".wdl";
+}
+
+// Every material split with up to maxPieces pieces and at least one piece a
+// side, in build order: fewer pieces first (captures lead there), and within
+// a piece count fewer men first (promotions lead there)
+std::vector<EgdbMaterial> egdbMaterials(int maxPieces) {
+    std::vector<EgdbMaterial> materials;
+    for (int pieces = 2; pieces <= maxPieces; pieces++) {
+        for (int men = 0; men <= pieces; men++) {
+            for (int whiteMen = 0; whiteMen <= men; whiteMen++) {
+                int blackMen = men - whiteMen;
+                for (int whiteKings = 0; whiteKings <= pieces - men; whiteKings++) {
+                    EgdbMaterial m{ whiteMen, whiteKings, blackMen, pieces - men - whiteKings };
+                    if (m.whiteMen + m.whiteKings > 0 && m.blackMen + m.blackKings > 0)
+                        materials.push_back(m);
+                }
+            }
+        }
+    }
+    return materials;
+}
+
+// Map every table up to maxPieces in dir; nothing is read until probed.
+// Missing files are skipped.
+int loadEndgameDatabase(const std::string& dir, int maxPieces) {
+    int loaded = 0;
+    for (const EgdbMaterial& m : egdbMaterials(std::min(maxPieces, EGDB_MAX_PIECES))) {
+        auto file = std::make_unique<EgdbFile>();
+        if (file->open(egdbFileName(dir, m), m)) {
+            egdb.add(std::move(file));
+            loaded++;
+        }
+    }
+    // Probing by piece count is only sound if every smaller material is there
+    egdb.maxPieces = 0;
+    for (int pieces = 2; pieces <= maxPieces; pieces++) {
+        bool complete = true;
+        for (const EgdbMaterial& m : egdbMaterials(pieces))
+            complete = complete && egdb.has(m);
+        if (!complete)
+            break;
+        egdb.maxPieces = pieces;
+    }
+    return loaded;
+}
+
+// Run body(threadIndex, begin, end) over [0, count) split across threads
+template <typename Body>
+void parallelFor(size_t count, int threads, Body body) {
+    std::vector<std::thread> workers;
+    size_t chunk = (count + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        size_t begin = std::min(count, t * chunk);
+        size_t end = std::min(count, begin + chunk);
+        workers.emplace_back(body, t, begin, end);
+    }
+    for (auto& worker : workers)
+        worker.join();
+}
+
+// Retrograde analysis of one slice, all of whose successors are in db.
+// Positions with no legal move are lost; then each pass marks a position won
+// if some move reaches a lost position, and lost if every move reaches a won
+// one, until a pass changes nothing. Whatever is left is a draw.
+// counts receives the number of positions per value, EGDB_INVALID for unused indices.
+EgdbSlice buildEgdbSlice(const EgdbMaterial& m, const EgdbSliceSet& db, int threads,
+                         std::array<uint64_t, 4>& counts) {
+    uint64_t size = m.size();
+    std::vector<std::atomic<uint8_t>> work(size);
+    for (auto& value : work)
+        value.store(EGDB_DRAW, std::memory_order_relaxed);
+
+    // Value of a successor for its own side to move
+    auto childValue = [&](const GameState& child) -> EgdbValue {
+        if ((child.whiteToMove ? child.white : child.black) == 0)
+            return EGDB_LOSS;  // Lost its last piece
+        EgdbMaterial cm = EgdbMaterial::of(child);
+        if (cm.key() == m.key())
+            return static_cast<EgdbValue>(work[egdbIndex(child, m)].load(std::memory_order_relaxed));
+        return db.find(cm)->get(egdbIndex(child, cm));
+    };
+
+    uint64_t resolved;
+    do {
+        std::atomic<uint64_t> resolvedInPass = 0;
+        parallelFor(size, threads, [&](int, size_t begin, size_t end) {
+            uint64_t count = 0;
+            for (size_t i = begin; i < end; i++) {
+                if (work[i].load(std::memory_order_relaxed) != EGDB_DRAW)
+                    continue;
+                GameState state;
+                if (!egdbPosition(i, m, state)) {
+                    work[i].store(EGDB_INVALID, std::memory_order_relaxed);
+                    continue;
+                }
+                MoveList moves = generateMoves(state);
+                EgdbValue value = EGDB_LOSS;
+                for (const Move* mv = moves.begin(); mv != moves.end() && value != EGDB_WIN; ++mv) {
+                    EgdbValue child = childValue(applyMove(state, *mv));
+                    if (child == EGDB_LOSS)
+                        value = EGDB_WIN;
+                    else if (child != EGDB_WIN)
+                        value = EGDB_DRAW;
+                }
+                if (value != EGDB_DRAW) {
+                    work[i].store(value, std::memory_order_relaxed);
+                    count++;
+                }
+            }
+            resolvedInPass += count;
+        });
+        resolved = resolvedInPass;
+    } while (resolved > 0);
+
+    EgdbSlice slice;
+    slice.material = m;
+    slice.values.assign((size + 3) / 4, 0);
+    uint8_t previous = EGDB_DRAW;
+    counts.fill(0);
+    for (uint64_t i = 0; i < size; i++) {
+        uint8_t value = work[i].load(std::memory_order_relaxed);
+        counts[value]++;
+        if (value == EGDB_INVALID)
+            value = previous;  // Never probed; extending the run compresses best
+        slice.values[i >> 2] |= value << ((i & 3) * 2);
+        previous = value;
+    }
+    return slice;
+}
+
+// Build and save every table up to maxPieces into dir
+bool buildEndgameDatabase(const std::string& dir, int maxPieces, int threads) {
+    EgdbSliceSet db;
+    for (const EgdbMaterial& m : egdbMaterials(maxPieces)) {
+        auto start = std::chrono::steady_clock::now();
+        std::array<uint64_t, 4> counts;
+        EgdbSlice slice = buildEgdbSlice(m, db, threads, counts);
+        if (!saveEgdbSlice(egdbFileName(dir, m), slice))
+            return false;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << m.name() << ": " << m.size() << " positions, " << counts[EGDB_WIN] << " won, "
+                  << counts[EGDB_LOSS] << " lost, " << counts[EGDB_DRAW] << " drawn, " << counts[EGDB_INVALID] << " unused ("
+                  << seconds << "s)" << std::endl;
+        db.add(std::move(slice));
+    }
+    return true;
+}
+
+// Database value as a search score from white's point of view. Won positions
+// keep the static eval on top so the search still prefers making progress.
+inline int egdbScore(EgdbValue value, const GameState& state) noexcept {
+    if (value == EGDB_DRAW)
+        return 0;
+    int eval = std::clamp(evaluateCached(state, -INF, INF), -EGDB_WIN_SCORE / 4, EGDB_WIN_SCORE / 4);
+    bool whiteWins = (value == EGDB_WIN) == state.whiteToMove;
+    return (whiteWins ? EGDB_WIN_SCORE : -EGDB_WIN_SCORE) + eval;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Distance-to-win tables
+//////////////////////////////////////////////////////////////////////////////
+
+// For the smallest endgames, the number of plies to the end of the game with
+// best play (the winner hurrying, the loser holding out), so won positions
+// can be converted directly instead of by searching. Built offline with
+// --build-dtw, one byte per position in the EGDB index order:
+//   0          draw (or unused index)
+//   plies + 1  odd plies: the side to move wins; even plies: it loses
+// Generated level by level: level L settles exactly the positions that end in
+// L plies, looking only at successors settled on earlier levels.
+constexpr uint32_t DTW_FILE_MAGIC = 0x57544443; // "CDTW"
+constexpr uint8_t DTW_UNUSED = 255;              // Generation only
+constexpr int DTW_MAX_PLIES = 253;
+
+struct DtwFileHeader {
+    uint32_t magic;
+    uint32_t materialKey;
+    uint64_t positions;
+};
+
+// Tables being generated, with the longest distance in any of them
+struct DtwSliceSet {
+    std::vector<std::vector<uint8_t>> slices;
+    std::vector<int32_t> sliceByKey = std::vector<int32_t>(1 << 16, -1);
+    int maxPlies = 0;
+
+    const std::vector<uint8_t>& find(const EgdbMaterial& m) const { return slices[sliceByKey[m.key()]]; }
+};
+
+// Distance table for one slice; false if the distances outgrow a byte
+bool buildDtwSlice(const EgdbMaterial& m, const DtwSliceSet& db, int threads, std::vector<uint8_t>& out,
+                   int& maxPlies) {
+    uint64_t size = m.size();
+    std::vector<std::atomic<uint8_t>> work(size);
+    for (auto& entry : work)
+        entry.store(0, std::memory_order_relaxed);
+
+    // Successor's entry, seen from the successor's side to move
+    auto childEntry = [&](const GameState& child) -> uint8_t {
+        if ((child.whiteToMove ? child.white : child.black) == 0)
+            return 1;  // Lost its last piece: lost in 0 plies
+        EgdbMaterial cm = EgdbMaterial::of(child);
+        if (cm.key() == m.key())
+            return work[egdbIndex(child, m)].load(std::memory_order_relaxed);
+        return db.find(cm)[egdbIndex(child, cm)];
+    };
+
+    maxPlies = 0;
+    for (int level = 0;; level++) {
+        if (level > DTW_MAX_PLIES)
+            return false;
+        std::atomic<uint64_t> settled = 0;
+        parallelFor(size, threads, [&](int, size_t begin, size_t end) {
+            uint64_t count = 0;
+            for (size_t i = begin; i < end; i++) {
+                if (work[i].load(std::memory_order_relaxed) != 0)
+                    continue;
+                GameState state;
+                if (!egdbPosition(i, m, state)) {
+                    work[i].store(DTW_UNUSED, std::memory_order_relaxed);
+                    continue;
+                }
+                MoveList moves = generateMoves(state);
+                bool settles;
+                if (level == 0) {
+                    settles = moves.count == 0;
+                } else if (level % 2 == 1) {
+                    // Won if some move reaches a position lost in fewer plies
+                    settles = false;
+                    for (const Move* mv = moves.begin(); mv != moves.end() && !settles; ++mv) {
+                        uint8_t child = childEntry(applyMove(state, *mv));
+                        settles = child != 0 && child != DTW_UNUSED && child <= level && (child - 1) % 2 == 0;
+                    }
+                } else {
+                    // Lost if every move reaches a position won in fewer plies
+                    settles = true;
+                    for (const Move* mv = moves.begin(); mv != moves.end() && settles; ++mv) {
+                        uint8_t child = childEntry(applyMove(state, *mv));
+                        settles = child != 0 && child <= level && (child - 1) % 2 == 1;
+                    }
+                }
+                if (settles) {
+                    work[i].store(static_cast<uint8_t>(level + 1), std::memory_order_relaxed);
+                    count++;
+                }
+            }
+            settled += count;
+        });
+        if (settled > 0)
+            maxPlies = level;
+        else if (level > db.maxPlies + 1)
+            break;  // Nothing left that the other tables' distances could still settle
+    }
+
+    out.resize(size);
+    for (uint64_t i = 0; i < size; i++) {
+        uint8_t entry = work[i].load(std::memory_order_relaxed);
+        out[i] = entry == DTW_UNUSED ? 0 : entry;
+    }
+    return true;
+}
+
+bool buildDtwTables(const std::string& dir, int maxPieces, int threads) {
+    DtwSliceSet db;
+    for (const EgdbMaterial& m : egdbMaterials(maxPieces)) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> distances;
+        int maxPlies;
+        if (!buildDtwSlice(m, db, threads, distances, maxPlies)) {
+            std::cerr << m.name() << ": distances exceed " << DTW_MAX_PLIES << " plies" << std::endl;
+            return false;
+        }
+        std::ofstream out(dir + "/" + m.name() + ".dtw", std::ios::binary);
+        DtwFileHeader header = { DTW_FILE_MAGIC, m.key(), m.size() };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(distances.data()), distances.size());
+        if (!out)
+            return false;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << m.name() << ": longest game " << maxPlies << " plies (" << seconds << "s)" << std::endl;
+        db.sliceByKey[m.key()] = static_cast<int32_t>(db.slices.size());
+        db.slices.push_back(std::move(distances));
+        db.maxPlies = std::max(db.maxPlies, maxPlies);
+    }
+    return true;
+}
+
+struct DtwTable {
+    MappedFile file;
+    const uint8_t* entries = nullptr;
+
+    bool open(const std::string& path, const EgdbMaterial& m) {
+        DtwFileHeader header;
+        if (!file.open(path) || file.size < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data, sizeof(header));
+        if (header.magic != DTW_FILE_MAGIC || header.materialKey != m.key() || header.positions != m.size() ||
+            file.size != sizeof(header) + header.positions)
+            return false;
+        entries = file.data + sizeof(header);
+        return true;
+    }
+};
+
+struct DistanceToWinTables {
+    std::vector<std::unique_ptr<DtwTable>> tables = std::vector<std::unique_ptr<DtwTable>>(1 << 16);
+    int maxPieces = 0;
+
+    // Plies to the end with best play (odd: the side to move wins), -1 for a
+    // draw; false if no table covers the position
+    bool probe(const GameState& state, int& plies) const noexcept {
+        if (std::popcount(state.white | state.black) > maxPieces)
+            return false;
+        EgdbMaterial m = EgdbMaterial::of(state);
+        const DtwTable* table = tables[m.key()].get();
+        if (!table)
+            return false;
+        plies = table->entries[egdbIndex(state, m)] - 1;
+        return true;
+    }
+
+    // The fastest win, or the longest defence, from a decided position
+    bool bestMove(const GameState& state, Move& best, int& plies) const noexcept {
+        if (!probe(state, plies) || plies < 0)
+            return false;
+        bool winning = plies % 2 == 1;
+        int bestChild = -1;
+        MoveList moves = generateMoves(state);
+        for (const Move* m = moves.begin(); m != moves.end(); ++m) {
+            GameState child = applyMove(state, *m);
+            int childPlies = 0;
+            if ((child.whiteToMove ? child.white : child.black) != 0 && !probe(child, childPlies))
+                return false;
+            bool better = winning ? childPlies >= 0 && childPlies % 2 == 0 && (bestChild < 0 || childPlies < bestChild)
+                                  : childPlies > bestChild;
+            if (better) {
+                bestChild = childPlies;
+                best = *m;
+            }
+        }
+        return bestChild >= 0;
+    }
+};
+
+DistanceToWinTables dtw;
+
+// Map the distance tables in dir; probing covers the largest complete piece count
+int loadDtwTables(const std::string& dir, int maxPieces) {
+    int loaded = 0;
+    for (const EgdbMaterial& m : egdbMaterials(std::min(maxPieces, EGDB_MAX_PIECES))) {
+        auto table = std::make_unique<DtwTable>();
+        if (table->open(dir + "/" + m.name() + ".dtw", m)) {
+            dtw.tables[m.key()] = std::move(table);
+            loaded++;
+        }
+    }
+    dtw.maxPieces = 0;
+    for (int pieces = 2; pieces <= maxPieces; pieces++) {
+        bool complete = true;
+        for (const EgdbMaterial& m : egdbMaterials(pieces))
+            complete = complete && dtw.tables[m.key()];
+        if (!complete)
+            break;
+        dtw.maxPieces = pieces;
+    }
+    return loaded;
+}
+
+// The tables ignore the no-progress rule, which turns a win that takes too
+// long into a draw. A decided result is trusted when the distance tables show
+// the win fits in what is left of the count, or, without a distance, while
+// the counter is in its first half.
+inline bool egdbWithinNoProgress(const GameState& state, EgdbValue value) noexcept {
+    if (value == EGDB_DRAW)
+        return true;
+    int plies;
+    if (dtw.probe(state, plies) && plies >= 0)
+        return state.quietPlies + plies < NO_PROGRESS_PLIES;
+    return state.quietPlies <= NO_PROGRESS_PLIES / 2;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Opening book
+//////////////////////////////////////////////////////////////////////////////
+
+// Book moves from deep self-play searches (--build-book), consulted before
+// searching. The file is a header followed by BookEntry records sorted by
+// position key, mapped as is and binary-searched. A book built with
+// canonical hashing holds white-to-move positions only; black-to-move
+// positions are looked up as their twin.
+constexpr uint32_t BOOK_FILE_MAGIC = 0x4B4F4243; // "CBOK"
+constexpr uint32_t BOOK_FILE_VERSION = 2;
+constexpr uint32_t BOOK_CANONICAL = 1;  // BookFileHeader flag
+
+struct BookEntry {
+    uint64_t key;     // computePositionKey
+    int32_t score;    // From white's point of view
+    uint16_t weight;  // Relative chance of being played
+    uint8_t from, to;
+};
+static_assert(sizeof(BookEntry) == 16, "BookEntry is stored on disk");
+
+struct BookFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+// Book key of a position: as is, or its twin with canonical hashing
+inline bool bookKeyFlipped(const GameState& state, bool canonical) noexcept {
+    return canonical && !state.whiteToMove;
+}
+
+inline uint64_t bookKey(const GameState& state, bool canonical) {
+    return computePositionKey(bookKeyFlipped(state, canonical) ? flipColours(state) : state);
+}
+
+struct OpeningBook {
+    MappedFile file;
+    const BookEntry* entries = nullptr;
+    size_t count = 0;
+    bool canonical = false;
+
+    bool open(const std::string& path) {
+        BookFileHeader header;
+        if (!file.open(path) || file.size < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data, sizeof(header));
+        if (header.magic != BOOK_FILE_MAGIC || header.version != BOOK_FILE_VERSION ||
+            file.size != sizeof(header) + header.count * sizeof(BookEntry))
+            return false;
+        entries = reinterpret_cast<const BookEntry*>(file.data + sizeof(header));
+        count = header.count;
+        canonical = (header.flags & BOOK_CANONICAL) != 0;
+        return true;
+    }
+
+    // Pick one of the book moves for this position at random by weight;
+    // entries that are not legal here (a key collision) are ignored
+    bool probe(const GameState& state, const MoveList& moves, Move& move, int& score) const {
+        bool flipped = bookKeyFlipped(state, canonical);
+        uint64_t key = bookKey(state, canonical);
+        const BookEntry* first = std::lower_bound(entries, entries + count, key,
+            [](const BookEntry& entry, uint64_t k) { return entry.key < k; });
+        std::vector<std::pair<Move, const BookEntry*>> candidates;
+        uint32_t totalWeight = 0;
+        for (const BookEntry* entry = first; entry != entries + count && entry->key == key; ++entry) {
+            uint8_t from = flipped ? flipSquare(entry->from) : entry->from;
+            uint8_t to = flipped ? flipSquare(entry->to) : entry->to;
+            for (const Move* m = moves.begin(); m != moves.end(); ++m) {
+                if (m->from == from && m->to == to && entry->weight > 0) {
+                    candidates.emplace_back(*m, entry);
+                    totalWeight += entry->weight;
+                }
+            }
+        }
+        if (candidates.empty())
+            return false;
+        uint32_t pick = std::uniform_int_distribution<uint32_t>(0, totalWeight - 1)(rng);
+        for (const auto& [candidate, entry] : candidates) {
+            if (pick < entry->weight) {
+                move = candidate;
+                score = flipped ? -entry->score : entry->score;
+                return true;
+            }
+            pick -= entry->weight;
+        }
+        return false;
+    }
+};
+
+OpeningBook openingBook;
+
+//////////////////////////////////////////////////////////////////////////////
+// Search statistics output
+//////////////////////////////////////////////////////////////////////////////
+
+// One human-readable line per search
+std::string searchStatsLine(const SearchStats& stats) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1)
+       << "depth " << stats.depth << ", " << stats.nodes << " nodes in " << stats.elapsedMs << " ms ("
+       << stats.nodesPerSecond() / 1000.0 << " knps), TT hits " << stats.ttHitRate() * 100.0
+       << "%, cutoffs " << stats.cutoffs << " (first move " << stats.firstMoveCutoffRate() * 100.0
+       << "%), aspiration re-searches " << stats.aspirationFailLows + stats.aspirationFailHighs
+       << "/" << stats.aspirationSearches << ", LMR " << stats.lmrReductions << " (re-searched "
+       << stats.lmrReSearches << "), futility " << stats.futilityPrunes << ", razor " << stats.razorPrunes
+       << ", ProbCut " << stats.probcutCuts << "/" << stats.probcutTries
+       << ", ETC cutoffs " << stats.etcCutoffs << " (" << stats.etcProbes << " probes)"
+       << ", extensions " << stats.extensions << ", EGDB hits " << stats.egdbHits
+       << " (block cache " << egdb.cache.hitRate() * 100.0 << "%), draws " << stats.draws
+       << ", EBF " << std::setprecision(2) << stats.effectiveBranchingFactor() << std::setprecision(1)
+       << ", eval cache " << stats.evalCacheHitRate() * 100.0 << "%, men cache "
+       << stats.menCacheHitRate() * 100.0 << "%";
+    return os.str();
+}
+
+// The same counters as a single-line JSON record
+std::string searchStatsJson(const SearchStats& stats) {
+    std::ostringstream os;
+    os << "{\"depth\":" << stats.depth << ",\"nodes\":" << stats.nodes
+       << ",\"time_ms\":" << stats.elapsedMs << ",\"nps\":" << static_cast<uint64_t>(stats.nodesPerSecond())
+       << ",\"tt_probes\":" << stats.ttProbes << ",\"tt_hits\":" << stats.ttHits
+       << ",\"tt_cutoffs\":" << stats.ttCutoffs << ",\"cutoffs\":" << stats.cutoffs
+       << ",\"first_move_cutoffs\":" << stats.firstMoveCutoffs
+       << ",\"aspiration_searches\":" << stats.aspirationSearches
+       << ",\"aspiration_fail_lows\":" << stats.aspirationFailLows
+       << ",\"aspiration_fail_highs\":" << stats.aspirationFailHighs
+       << ",\"lmr_reductions\":" << stats.lmrReductions << ",\"lmr_re_searches\":" << stats.lmrReSearches
+       << ",\"futility_prunes\":" << stats.futilityPrunes << ",\"razor_prunes\":" << stats.razorPrunes
+       << ",\"probcut_tries\":" << stats.probcutTries << ",\"probcut_cuts\":" << stats.probcutCuts
+       << ",\"etc_probes\":" << stats.etcProbes << ",\"etc_cutoffs\":" << stats.etcCutoffs
+       << ",\"extensions\":" << stats.extensions << ",\"egdb_hits\":" << stats.egdbHits
+       << ",\"egdb_cache_hit_rate\":" << egdb.cache.hitRate() << ",\"draws\":" << stats.draws
+       << ",\"ebf\":" << stats.effectiveBranchingFactor()
+       << ",\"eval_cache_hit_rate\":" << stats.evalCacheHitRate()
+       << ",\"men_cache_hit_rate\":" << stats.menCacheHitRate() << ",\"nodes_per_ply\":[";
+    int deepest = stats.deepestPly();
+    for (int ply = 0; ply <= deepest; ply++)
+        os << (ply ? "," : "") << stats.nodesAtPly[ply];
+    os << "],\"branching_per_ply\":[";
+    for (int ply = 1; ply <= deepest; ply++)
+        os << (ply > 1 ? "," : "") << stats.branchingAtPly(ply);
+    os << "]}";
+    return os.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Principal variation
+//////////////////////////////////////////////////////////////////////////////
+
+// Triangular PV table: row `ply` holds the best line found from that ply,
+// moves[ply][ply .. length[ply] - 1]. A node copies its child's row behind
+// its own move whenever that move raises the bound, so the root row ends up
+// holding the whole principal variation.
+struct PvTable {
+    std::array<std::array<Move, MAX_PLY>, MAX_PLY> moves;
+    std::array<int, MAX_PLY> length{};
+
+    inline void clear(int ply) noexcept { length[ply] = ply; }
+
+    inline void update(int ply, const Move& move) noexcept {
+        moves[ply][ply] = move;
+        int childLength = ply + 1 < MAX_PLY ? length[ply + 1] : ply + 1;
+        for (int i = ply + 1; i < childLength; i++)
+            moves[ply][i] = moves[ply + 1][i];
+        length[ply] = std::max(childLength, ply + 1);
+    }
+};
+
+// The previous iteration's PV, searched first along its path so the next
+// iteration starts from the line it is most likely to confirm
+struct PvHint {
+    std::array<Move, MAX_PLY> moves;
+    int length = 0;
+    bool follow = false;
+
+    void set(const std::vector<Move>& pv) noexcept {
+        length = static_cast<int>(std::min<size_t>(pv.size(), MAX_PLY));
+        std::copy(pv.begin(), pv.begin() + length, moves.begin());
+        follow = length > 0;
+    }
+
+    // Move the hinted move for this ply to the front; leaves the PV path
+    // as soon as the hint runs out or the hinted move is not legal here
+    inline void order(MoveList& moves, int ply) noexcept {
+        if (ply >= length) {
+            follow = false;
+            return;
+        }
+        for (int i = 0; i < moves.count; i++) {
+            if (moves.moves[i] == this->moves[ply]) {
+                std::swap(moves.moves[0], moves.moves[i]);
+                return;
+            }
+        }
+        follow = false;
+    }
 };
 
-void printGameState(const GameState& state) {
-    std::cout << "  0 1 2 3 4 5 6 7\n";
-    for (int row = 0; row < 8; row++) {
-        std::cout << row << " ";
-        for (int col = 0; col < 8; col++) {
-            if ((row + col) % 2 == 0)
-                std::cout << "  ";
-            else {
-                int idx = indexFromRC(row, col);
-                char cell = '.';
-                if (state.white & (1U << idx))
-                    cell = (state.kings & (1U << idx)) ? 'W' : 'w';
-                else if (state.black & (1U << idx))
-                    cell = (state.kings & (1U << idx)) ? 'B' : 'b';
-                std::cout << cell << " ";
-            }
+thread_local PvTable pvTable;
+thread_local PvHint pvHint;
+
+// Outcome of a root search
+struct SearchResult {
+    Move bestMove;
+    int score = 0;          // From white's point of view, like minimax
+    int depth = 0;          // Last completed iteration
+    std::vector<Move> pv;   // Starts with bestMove
+};
+
+std::string pvString(const std::vector<Move>& pv) {
+    std::ostringstream os;
+    for (size_t i = 0; i < pv.size(); i++)
+        os << (i ? " " : "") << static_cast<int>(pv[i].from) << "-" << static_cast<int>(pv[i].to);
+    return os.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Search parameters
+//////////////////////////////////////////////////////////////////////////////
+
+// Selectivity knobs for minimax, settable with --search-param <name> <value>.
+// Margins are in evaluation units (a man is worth roughly 100).
+struct SearchParams {
+    int lmrMinDepth = 3;          // Reduce only with at least this much depth left
+    int lmrFullMoves = 3;         // Moves searched at full depth before reducing
+    int lmrReduction = 1;         // Plies taken off a late quiet move
+    int futilityMargin1 = 120;    // Skip quiet moves at depth 1 if eval + margin cannot reach the bound
+    int futilityMargin2 = 250;    // ... and at depth 2
+    int razorMargin = 350;        // At depth 2, verify hopeless nodes with a depth 1 search
+    int maxExtensionPly = 64;     // Forced replies are not extended beyond this ply
+    // ProbCut: the deep score is predicted from a shallower search as
+    // slope / 100 * shallow + intercept, off by sigma on average (--fit-probcut)
+    int probcutMinDepth = 6;      // Try at nodes with this much depth left (0 disables)
+    int probcutReduction = 4;     // Plies the shallow search is short of the deep one
+    int probcutSlope = 88;        // Fitted on depth-11 analysis of random openings: deep 6-9 vs shallow 2-5
+    int probcutIntercept = 9;
+    int probcutSigma = 129;
+    int probcutThreshold = 150;   // Cut when the prediction is threshold / 100 sigmas past the bound
+    int etcMinDepth = 4;          // Probe the children in the TT first at this depth and above (0 disables)
+};
+
+SearchParams searchParams;
+
+bool setSearchParam(const std::string& name, int value) {
+    static const std::pair<const char*, int SearchParams::*> fields[] = {
+        {"lmr_min_depth", &SearchParams::lmrMinDepth},
+        {"lmr_full_moves", &SearchParams::lmrFullMoves},
+        {"lmr_reduction", &SearchParams::lmrReduction},
+        {"futility_margin_1", &SearchParams::futilityMargin1},
+        {"futility_margin_2", &SearchParams::futilityMargin2},
+        {"razor_margin", &SearchParams::razorMargin},
+        {"max_extension_ply", &SearchParams::maxExtensionPly},
+        {"probcut_min_depth", &SearchParams::probcutMinDepth},
+        {"probcut_reduction", &SearchParams::probcutReduction},
+        {"probcut_slope", &SearchParams::probcutSlope},
+        {"probcut_intercept", &SearchParams::probcutIntercept},
+        {"probcut_sigma", &SearchParams::probcutSigma},
+        {"probcut_threshold", &SearchParams::probcutThreshold},
+        {"etc_min_depth", &SearchParams::etcMinDepth},
+    };
+    for (const auto& [fieldName, field] : fields) {
+        if (name == fieldName) {
+            searchParams.*field = value;
+            return true;
         }
-        std::cout << "\n";
     }
-    std::cout << (state.whiteToMove ? "White" : "Black") << " to move\n";
+    return false;
+}
+
+// With --probcut-log, ProbCut cuts are off and every eligible node with an
+// exact score appends "<depth> <shallow score> <deep score>" here instead;
+// --fit-probcut turns such a log into the slope, intercept and sigma above
+std::ofstream probcutLog;
+std::mutex probcutLogMutex;
+
+// Quiet moves are the ones pruning may touch: no capture and no promotion
+inline bool isQuietMove(const GameState& state, const Move& m) noexcept {
+    if (m.type < URMove)
+        return false;
+    Bitboard from = 1U << m.from, to = 1U << m.to;
+    if (state.kings & from)
+        return true;
+    return !(to & ((state.white & from) ? PROMOTION_ZONE_WHITE : PROMOTION_ZONE_BLACK));
+}
+
+// Recognised draws, scored without searching: the no-progress rule, and a
+// lone king against a lone king with both on the double-corner diagonals
+// (DRAWN_KING_SQUARES) and neither attacked. Elsewhere a lone king can be
+// trapped, so kings-only endings are not drawn in general; every position
+// this accepts was checked against the 1 v 1 endgame table.
+constexpr Bitboard DRAWN_KING_SQUARES = 0x8CC66331;
+constexpr int DRAW_SCORE = 0;
+
+inline bool isRecognisedDraw(const GameState& state) noexcept {
+    if (state.quietPlies >= NO_PROGRESS_PLIES)
+        return true;
+    if (state.kings != state.occupied() || std::popcount(state.white) != 1 || std::popcount(state.black) != 1)
+        return false;
+    return (state.kings & ~DRAWN_KING_SQUARES) == 0 && piecesUnderThreat(state, true) == 0 &&
+           piecesUnderThreat(state, false) == 0;
 }
 
 // Alpha-beta minimax search with transposition table
 inline int minimax(const GameState& state, int depth, int alpha, int beta,
-                   TranspositionTable& tt) noexcept {
-    if (depth == 0)
-        return evaluateState(state);
+                   TranspositionTable& tt, int ply = 1) noexcept {
+    searchStats.nodes++;
+    searchStats.nodesAtPly[std::min(ply, MAX_PLY - 1)]++;
+    pvTable.clear(std::min(ply, MAX_PLY - 1));
+    if (isRecognisedDraw(state)) {
+        searchStats.draws++;
+        return DRAW_SCORE;
+    }
+    EgdbValue egdbValue;
+    if (egdb.probe(state, egdbValue) && egdbWithinNoProgress(state, egdbValue)) {
+        // Exact result from the endgame tables; nothing below needs searching
+        searchStats.egdbHits++;
+        return egdbScore(egdbValue, state);
+    }
+    if (depth == 0 || ply >= MAX_PLY - 1)
+        return evaluateCached(state, alpha, beta);
     
     int ttEval;
     TranspositionTable::Flag ttFlag;
-    if (tt.lookup(state.hash, depth, ttEval, ttFlag)) {
-        if (ttFlag == TranspositionTable::EXACT)
-            return ttEval;
-        if (ttFlag == TranspositionTable::LOWER && ttEval >= beta)
-            return ttEval;
-        if (ttFlag == TranspositionTable::UPPER && ttEval <= alpha)
+    searchStats.ttProbes++;
+    if (tt.lookup(state, depth, ttEval, ttFlag)) {
+        searchStats.ttHits++;
+        if (ttFlag == TranspositionTable::EXACT ||
+            (ttFlag == TranspositionTable::LOWER && ttEval >= beta) ||
+            (ttFlag == TranspositionTable::UPPER && ttEval <= alpha)) {
+            searchStats.ttCutoffs++;
             return ttEval;
+        }
     }
     
     // Save the original bounds
@@ -955,20 +3517,146 @@ inline int minimax(const GameState& state, int depth, int alpha, int beta,
     MoveList moves = generateMoves(state);
     if (moves.count == 0)
         return state.whiteToMove ? -INF : INF;
+    if (pvHint.follow)
+        pvHint.order(moves, ply);
+    
+    // Near the leaves, a static eval far outside the window lets quiet moves
+    // be skipped (futility) or the whole node be checked with a shallower
+    // search first (razoring). Captures are compulsory, so a move list that
+    // starts with a capture has no quiet moves and is never pruned.
+    const SearchParams& sp = searchParams;
+    bool canPrune = depth <= 2 && moves.moves[0].type >= URMove &&
+                    alpha > -INF / 2 && beta < INF / 2;
+    int staticEval = canPrune ? evaluateCached(state, -INF, INF) : 0;
+    if (canPrune && depth == 2) {
+        bool hopeless = state.whiteToMove ? staticEval + sp.razorMargin <= alpha
+                                          : staticEval - sp.razorMargin >= beta;
+        if (hopeless) {
+            int eval = minimax(state, 1, alpha, beta, tt, ply);
+            if (state.whiteToMove ? eval <= alpha : eval >= beta) {
+                searchStats.razorPrunes++;
+                return eval;
+            }
+        }
+    }
+    int futilityMargin = depth == 1 ? sp.futilityMargin1 : sp.futilityMargin2;
+    
+    // Enhanced transposition cutoff: before searching any child, look for
+    // one whose stored bound already refutes this node. Every child's slot
+    // is prefetched first so the probes overlap their cache misses.
+    if (sp.etcMinDepth > 0 && depth >= sp.etcMinDepth && moves.count > 1) {
+        std::array<uint32_t, std::tuple_size_v<decltype(MoveList::moves)>> childKeys;
+        bool childFlipped = canonicalHashing && state.whiteToMove;  // Children have black to move
+        for (int i = 0; i < moves.count; i++) {
+            childKeys[i] = cacheKeyAfter(state, moves.moves[i]);
+            tt.prefetch(childKeys[i]);
+        }
+        for (int i = 0; i < moves.count; i++) {
+            int childEval;
+            TranspositionTable::Flag childFlag;
+            searchStats.etcProbes++;
+            if (!tt.lookup(childKeys[i], childFlipped, depth - 1, childEval, childFlag))
+                continue;
+            bool refutes = state.whiteToMove
+                ? childFlag != TranspositionTable::UPPER && childEval >= beta
+                : childFlag != TranspositionTable::LOWER && childEval <= alpha;
+            if (refutes) {
+                searchStats.etcCutoffs++;
+                tt.store(state, depth, childEval,
+                         state.whiteToMove ? TranspositionTable::LOWER : TranspositionTable::UPPER);
+                return childEval;
+            }
+        }
+    }
+    
+    // ProbCut: far from the leaves, a shallow null-window search at a bound
+    // shifted by the fitted model predicts whether the deep search would
+    // fail high (white to move) or low (black to move); if so, cut here.
+    // Forced nodes and near-mate windows are left alone.
+    bool probcutNode = sp.probcutMinDepth > 0 && sp.probcutSlope > 0 && depth >= sp.probcutMinDepth &&
+                       moves.count > 1 && alpha > -EGDB_WIN_SCORE / 2 && beta < EGDB_WIN_SCORE / 2;
+    int shallowDepth = std::max(0, depth - sp.probcutReduction);
+    int shallowEval = 0;
+    if (probcutNode && probcutLog.is_open()) {
+        shallowEval = minimax(state, shallowDepth, -INF, INF, tt, ply);
+    } else if (probcutNode) {
+        searchStats.probcutTries++;
+        int margin = sp.probcutThreshold * sp.probcutSigma / 100;
+        if (state.whiteToMove) {
+            int bound = (beta + margin - sp.probcutIntercept) * 100 / sp.probcutSlope;
+            if (minimax(state, shallowDepth, bound - 1, bound, tt, ply) >= bound) {
+                searchStats.probcutCuts++;
+                return beta;
+            }
+        } else {
+            int bound = (alpha - margin - sp.probcutIntercept) * 100 / sp.probcutSlope;
+            if (minimax(state, shallowDepth, bound, bound + 1, tt, ply) <= bound) {
+                searchStats.probcutCuts++;
+                return alpha;
+            }
+        }
+    }
+    
+    // A forced reply (usually a lone capture) costs no depth, so forced
+    // sequences are followed to the end; the ply cap bounds long chains
+    int newDepth = depth - 1;
+    if (moves.count == 1 && ply < std::min(sp.maxExtensionPly, MAX_PLY - 2)) {
+        newDepth = depth;
+        searchStats.extensions++;
+    }
     
     int bestEval = state.whiteToMove ? -INF : INF;
     for (const Move* m = moves.begin(); m != moves.end(); ++m) {
+        int moveIndex = static_cast<int>(m - moves.begin());
+        bool quiet = moveIndex > 0 && isQuietMove(state, *m);
+        if (canPrune && quiet) {
+            // The bound this move would have to beat is out of reach; count
+            // the margin as its score so a fail-low return stays a valid bound
+            if (state.whiteToMove && staticEval + futilityMargin <= alpha) {
+                bestEval = std::max(bestEval, staticEval + futilityMargin);
+                searchStats.futilityPrunes++;
+                continue;
+            }
+            if (!state.whiteToMove && staticEval - futilityMargin >= beta) {
+                bestEval = std::min(bestEval, staticEval - futilityMargin);
+                searchStats.futilityPrunes++;
+                continue;
+            }
+        }
+        
         GameState child = applyMove(state, *m);
-        int eval = minimax(child, depth - 1, alpha, beta, tt);
+        int eval;
+        if (quiet && depth >= sp.lmrMinDepth && moveIndex >= sp.lmrFullMoves) {
+            // Late move reduction, re-searched at full depth if it beats the bound
+            searchStats.lmrReductions++;
+            int reducedDepth = std::max(0, newDepth - sp.lmrReduction);
+            eval = minimax(child, reducedDepth, alpha, beta, tt, ply + 1);
+            if (state.whiteToMove ? eval > alpha : eval < beta) {
+                searchStats.lmrReSearches++;
+                eval = minimax(child, newDepth, alpha, beta, tt, ply + 1);
+            }
+        } else {
+            eval = minimax(child, newDepth, alpha, beta, tt, ply + 1);
+        }
         if (state.whiteToMove) {
             bestEval = std::max(bestEval, eval);
-            alpha = std::max(alpha, eval);
+            if (eval > alpha) {
+                alpha = eval;
+                pvTable.update(ply, *m);
+            }
         } else {
             bestEval = std::min(bestEval, eval);
-            beta = std::min(beta, eval);
+            if (eval < beta) {
+                beta = eval;
+                pvTable.update(ply, *m);
+            }
         }
-        if (beta <= alpha)
+        if (beta <= alpha) {
+            searchStats.cutoffs++;
+            if (m == moves.begin())
+                searchStats.firstMoveCutoffs++;
             break;
+        }
     }
     
     TranspositionTable::Flag flag;
@@ -979,36 +3667,144 @@ inline int minimax(const GameState& state, int depth, int alpha, int beta,
     else
         flag = TranspositionTable::EXACT;
     
-    tt.store(state.hash, depth, bestEval, flag);
+    tt.store(state, depth, bestEval, flag);
+    if (probcutNode && probcutLog.is_open() && flag == TranspositionTable::EXACT &&
+        std::abs(bestEval) < EGDB_WIN_SCORE / 2 && std::abs(shallowEval) < EGDB_WIN_SCORE / 2) {
+        std::lock_guard<std::mutex> lock(probcutLogMutex);
+        probcutLog << depth << " " << shallowEval << " " << bestEval << "\n";
+    }
     return bestEval;
 }
 
-Move findBestMove(const GameState& state, int depth,std::vector<Move>* gameHistory) {
-    //if (state.whiteToMove)
-    //{
-    //std::cout <<  "White turn\n" ;
-    //}
-    //else {
+//////////////////////////////////////////////////////////////////////////////
+// Persistent move cache
+//////////////////////////////////////////////////////////////////////////////
 
-    //std::cout <<  "Black turn\n" ;
-    //}
-    MoveList moves = generateMoves(state);
-    if (moves.count == 0)
-        throw std::runtime_error("No legal moves available");
-    
-    TranspositionTable tt(1 << 25);  // 4M entries
-    Move bestMove = moves.moves[0];
+// Root search results kept on disk between runs (--move-cache). The file is
+// a header and a power-of-two array of entries, mapped read-write: a position
+// hashes to a bucket by its 64-bit key and lives in one of the next
+// MOVE_CACHE_PROBES slots, so a lookup touches at most one or two pages.
+// Entries carry the whole position, so a key collision is never mistaken
+// for a hit.
+constexpr uint32_t MOVE_CACHE_MAGIC = 0x434D5643; // "CVMC"
+constexpr uint32_t MOVE_CACHE_VERSION = 2;
+constexpr int MOVE_CACHE_PROBES = 8;
+
+struct MoveCacheEntry {
+    uint64_t key;       // computePositionKey; 0 marks an empty slot
+    Bitboard white, black, kings;
+    int32_t score;      // From white's point of view
+    uint8_t depth;
+    uint8_t from, to;
+    uint8_t whiteToMove;
+    uint8_t quietPlies;  // The no-progress counter changes the result
+    uint8_t reserved[3];
+};
+static_assert(sizeof(MoveCacheEntry) == 32, "MoveCacheEntry is stored on disk");
+
+struct MoveCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entrySize;
+    uint32_t reserved;
+    uint64_t entries;
+};
+
+struct MoveCache {
+    MappedFile file;
+    MoveCacheEntry* entries = nullptr;
+    uint64_t mask = 0;
+
+    bool open(const std::string& path, uint64_t entryCount) {
+        if (entryCount == 0 || (entryCount & (entryCount - 1)))
+            return false;
+        size_t bytes = sizeof(MoveCacheHeader) + entryCount * sizeof(MoveCacheEntry);
+        if (!file.open(path, bytes))
+            return false;
+        MoveCacheHeader header = { MOVE_CACHE_MAGIC, MOVE_CACHE_VERSION, sizeof(MoveCacheEntry), 0, entryCount };
+        if (file.created)
+            std::memcpy(file.data, &header, sizeof(header));
+        else if (file.size >= sizeof(header))
+            std::memcpy(&header, file.data, sizeof(header));
+        // An existing cache keeps the size it was created with, and is only
+        // written to once its header checks out
+        if (file.size < sizeof(header) || header.magic != MOVE_CACHE_MAGIC || header.version != MOVE_CACHE_VERSION ||
+            header.entrySize != sizeof(MoveCacheEntry) || header.entries == 0 ||
+            (header.entries & (header.entries - 1)) ||
+            file.size < sizeof(header) + header.entries * sizeof(MoveCacheEntry)) {
+            file.close();
+            return false;
+        }
+        entries = reinterpret_cast<MoveCacheEntry*>(file.data + sizeof(header));
+        mask = header.entries - 1;
+        return true;
+    }
+
+    static bool matches(const MoveCacheEntry& entry, uint64_t key, const GameState& state) noexcept {
+        return entry.key == key && entry.white == state.white && entry.black == state.black &&
+               entry.kings == state.kings && entry.whiteToMove == state.whiteToMove &&
+               entry.quietPlies == state.quietPlies;
+    }
+
+    // A stored result searched at least minDepth deep, if any
+    const MoveCacheEntry* lookup(const GameState& state, int minDepth) const noexcept {
+        if (!entries)
+            return nullptr;
+        uint64_t key = computePositionKey(state) | 1;
+        for (int i = 0; i < MOVE_CACHE_PROBES; i++) {
+            const MoveCacheEntry& entry = entries[(key + i) & mask];
+            if (entry.key == 0)
+                return nullptr;
+            if (matches(entry, key, state))
+                return entry.depth >= minDepth ? &entry : nullptr;
+        }
+        return nullptr;
+    }
+
+    // Record a result, replacing a shallower one for the same position or
+    // else the shallowest entry among the probed slots
+    void store(const GameState& state, const SearchResult& result) noexcept {
+        if (!entries)
+            return;
+        uint64_t key = computePositionKey(state) | 1;
+        MoveCacheEntry* target = nullptr;
+        for (int i = 0; i < MOVE_CACHE_PROBES; i++) {
+            MoveCacheEntry& entry = entries[(key + i) & mask];
+            if (entry.key == 0 || matches(entry, key, state)) {
+                if (entry.key != 0 && entry.depth > result.depth)
+                    return;
+                target = &entry;
+                break;
+            }
+            if (!target || entry.depth < target->depth)
+                target = &entry;
+        }
+        *target = { key, state.white, state.black, state.kings, result.score,
+                    static_cast<uint8_t>(std::min(result.depth, 255)), result.bestMove.from,
+                    result.bestMove.to, static_cast<uint8_t>(state.whiteToMove), state.quietPlies, {} };
+    }
+};
+
+MoveCache moveCache;
+
+// One full-width pass over the root moves at a fixed depth. Repeating a move
+// already played twice this game is penalised here, where the history is known.
+// The score is exact only if it lies strictly inside (alpha, beta).
+SearchResult searchRoot(const GameState& state, MoveList moves, int depth, int alpha, int beta,
+                        TranspositionTable& tt, const std::vector<Move>& gameHistory) {
+    SearchResult result;
+    result.bestMove = moves.moves[0];
+    result.depth = depth;
     int bestValue = state.whiteToMove ? -INF : INF;
-    int alpha = -INF, beta = INF;
+    pvTable.clear(0);
+    if (pvHint.follow)
+        pvHint.order(moves, 0);
     
     for (const Move* m = moves.begin(); m != moves.end(); ++m) {
-        //std::cout << "from :" << int(m->from) << "  to :" << int(m->to)<< std::endl;
         GameState child = applyMove(state, *m);
         int moveValue = minimax(child, depth - 1, alpha, beta, tt);
-        //std::cout << "best move evaluation score before repetition checking is :" << moveValue << std::endl;
-        // Check if this state has been repeated more than twice
-        int repeatCount = std::count(gameHistory->begin(), gameHistory->end(), *m);
-        //std::cout << "repat count: " << repeatCount << std::endl;
+        // Check if this move has been repeated more than twice
+        int repeatCount = std::count(gameHistory.begin(), gameHistory.end(), *m);
         if (repeatCount >= 2) {
             if (state.whiteToMove) {
                 moveValue -= (1000000 * repeatCount);  // Punish for repeating (white is maximizing)
@@ -1017,37 +3813,532 @@ Move findBestMove(const GameState& state, int depth,std::vector<Move>* gameHisto
                 moveValue += (1000000 * repeatCount);  // Punish for repeating (black is minimizing)
             }
         }
-        if (state.whiteToMove) {
-            if (moveValue > bestValue) {
-                bestValue = moveValue;
-                bestMove = *m;
+        if (state.whiteToMove ? moveValue > bestValue : moveValue < bestValue) {
+            bestValue = moveValue;
+            result.bestMove = *m;
+            pvTable.update(0, *m);
+            if (state.whiteToMove)
                 alpha = std::max(alpha, bestValue);
+            else
+                beta = std::min(beta, bestValue);
+        }
+        if (beta <= alpha)
+            break;  // Failed high against an aspiration window
+    }
+    
+    result.score = bestValue;
+    result.pv.assign(pvTable.moves[0].begin(), pvTable.moves[0].begin() + pvTable.length[0]);
+    if (result.pv.empty())
+        result.pv.push_back(result.bestMove);
+    return result;
+}
+
+// Aspiration windows: from ASPIRATION_MIN_DEPTH on, each iteration starts with
+// a window of ±ASPIRATION_WINDOW around the previous score. A fail low or high
+// is re-searched with that side of the window ASPIRATION_GROWTH times wider,
+// and opened fully once the window passes ASPIRATION_MAX_WINDOW.
+constexpr int ASPIRATION_MIN_DEPTH = 3;
+constexpr int ASPIRATION_WINDOW = 25;
+constexpr int ASPIRATION_GROWTH = 4;
+constexpr int ASPIRATION_MAX_WINDOW = 1000;
+
+SearchResult searchWithAspiration(const GameState& state, const MoveList& moves, int depth,
+                                  int previousScore, TranspositionTable& tt,
+                                  const std::vector<Move>& gameHistory) {
+    // Shallow scores swing too much, and there is nothing to centre on near a win
+    if (depth < ASPIRATION_MIN_DEPTH || std::abs(previousScore) >= INF / 2)
+        return searchRoot(state, moves, depth, -INF, INF, tt, gameHistory);
+    
+    int lowDelta = ASPIRATION_WINDOW, highDelta = ASPIRATION_WINDOW;
+    searchStats.aspirationSearches++;
+    while (true) {
+        int alpha = lowDelta > ASPIRATION_MAX_WINDOW ? -INF : previousScore - lowDelta;
+        int beta = highDelta > ASPIRATION_MAX_WINDOW ? INF : previousScore + highDelta;
+        SearchResult result = searchRoot(state, moves, depth, alpha, beta, tt, gameHistory);
+        if (result.score <= alpha && alpha > -INF) {
+            searchStats.aspirationFailLows++;
+            lowDelta *= ASPIRATION_GROWTH;
+        } else if (result.score >= beta && beta < INF) {
+            searchStats.aspirationFailHighs++;
+            highDelta *= ASPIRATION_GROWTH;
+        } else {
+            return result;
+        }
+        // Keep following the line the failed search found
+        pvHint.set(result.pv);
+    }
+}
+
+// Iterative deepening up to `depth`; each iteration searches the previous
+// iteration's PV first and shares the transposition table with it
+SearchResult findBestMove(const GameState& state, int depth, std::vector<Move>* gameHistory) {
+    MoveList moves = generateMoves(state);
+    if (moves.count == 0)
+        throw std::runtime_error("No legal moves available");
+    
+    auto searchStart = std::chrono::steady_clock::now();
+    searchStats.reset();
+    searchStats.depth = depth;
+    searchStats.nodes = 1;
+    searchStats.nodesAtPly[0] = 1;
+    pvHint.length = 0;
+    pvHint.follow = false;
+
+    SearchResult result;
+    int plies;
+    if (moves.count == 1) {
+        // Forced move (typically a compulsory capture): nothing to search
+        result.bestMove = moves.moves[0];
+        result.pv.assign(1, result.bestMove);
+        result.score = evaluateCached(applyMove(state, result.bestMove), -INF, INF);
+        searchStats.depth = 0;
+    } else if (openingBook.count && openingBook.probe(state, moves, result.bestMove, result.score)) {
+        result.pv.assign(1, result.bestMove);
+        searchStats.depth = 0;
+    } else if (dtw.probe(state, plies) && plies % 2 == 1 && state.quietPlies + plies < NO_PROGRESS_PLIES) {
+        // Won endgame: play the fastest win straight from the distance tables,
+        // if it completes before the no-progress rule draws it
+        GameState line = state;
+        Move move;
+        int remaining;
+        while (static_cast<int>(result.pv.size()) < MAX_PLY && dtw.bestMove(line, move, remaining)) {
+            result.pv.push_back(move);
+            line = applyMove(line, move);
+        }
+        // Without a line (a child no table covers) the search below takes over
+        if (!result.pv.empty()) {
+            result.bestMove = result.pv[0];
+            result.score = state.whiteToMove ? INF - plies : plies - INF;
+            searchStats.depth = 0;
+        }
+    } else if (const MoveCacheEntry* cached = moveCache.lookup(state, depth)) {
+        // Searched at least this deep in an earlier game; skip it if playing
+        // it again would draw the repetition penalty
+        Move move(cached->from, cached->to, URMove);
+        auto legal = std::find(moves.begin(), moves.end(), move);
+        if (legal != moves.end() && std::count(gameHistory->begin(), gameHistory->end(), *legal) < 2) {
+            result.bestMove = *legal;
+            result.pv.assign(1, result.bestMove);
+            result.score = cached->score;
+            result.depth = cached->depth;
+            searchStats.depth = 0;
+        }
+    }
+    if (result.pv.empty()) {
+        if (transpositionTable.size() == 0)
+            transpositionTable.resize(DEFAULT_TT_ENTRIES);
+        transpositionTable.newSearch();
+        for (int iteration = 1; iteration <= depth; iteration++) {
+            result = searchWithAspiration(state, moves, iteration, result.score, transpositionTable, *gameHistory);
+            pvHint.set(result.pv);
+        }
+        // A result bent by the repetition penalty belongs to this game only
+        bool penalised = std::any_of(moves.begin(), moves.end(), [&](const Move& m) {
+            return std::count(gameHistory->begin(), gameHistory->end(), m) >= 2;
+        });
+        if (!penalised)
+            moveCache.store(state, result);
+    }
+    
+    searchStats.elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - searchStart).count();
+    gameHistory->push_back(result.bestMove);
+    return result;
+}
+
+// Multi-PV analysis: exact scores and PVs for the `lines` best root moves,
+// best first. Rather than re-searching with earlier picks excluded, every
+// root move is searched once per iteration against the current lines-th best
+// score: moves that cannot enter the top N fail low cheaply, the others come
+// back exact. All moves and iterations share one transposition table.
+std::vector<SearchResult> searchMultiPv(const GameState& state, int depth, int lines,
+                                        TranspositionTable& tt = transpositionTable) {
+    MoveList moves = generateMoves(state);
+    if (moves.count == 0)
+        throw std::runtime_error("No legal moves available");
+    lines = std::clamp(lines, 1, moves.count);
+    
+    auto searchStart = std::chrono::steady_clock::now();
+    searchStats.reset();
+    searchStats.depth = depth;
+    searchStats.nodes = 1;
+    searchStats.nodesAtPly[0] = 1;
+    
+    auto better = [&state](const SearchResult& a, const SearchResult& b) {
+        return state.whiteToMove ? a.score > b.score : a.score < b.score;
+    };
+    std::vector<SearchResult> ranked(moves.count);
+    for (int i = 0; i < moves.count; i++) {
+        ranked[i].bestMove = moves.moves[i];
+        ranked[i].pv.assign(1, moves.moves[i]);
+    }
+    
+    if (tt.size() == 0)
+        tt.resize(DEFAULT_TT_ENTRIES);
+    tt.newSearch();
+    for (int iteration = 1; iteration <= depth; iteration++) {
+        std::vector<SearchResult> next;
+        next.reserve(ranked.size());
+        // Moves are visited in the previous iteration's order
+        for (const SearchResult& previous : ranked) {
+            int alpha = -INF, beta = INF;
+            if (static_cast<int>(next.size()) >= lines)
+                (state.whiteToMove ? alpha : beta) = next[lines - 1].score;
+            
+            pvHint.set(previous.pv);
+            GameState child = applyMove(state, previous.bestMove);
+            SearchResult line;
+            line.bestMove = previous.bestMove;
+            line.depth = iteration;
+            line.score = minimax(child, iteration - 1, alpha, beta, tt);
+            line.pv.assign(1, line.bestMove);
+            if (state.whiteToMove ? line.score > alpha : line.score < beta)
+                line.pv.insert(line.pv.end(), pvTable.moves[1].begin() + 1,
+                               pvTable.moves[1].begin() + pvTable.length[1]);
+            next.insert(std::upper_bound(next.begin(), next.end(), line, better), line);
+        }
+        ranked = std::move(next);
+    }
+    
+    searchStats.elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - searchStart).count();
+    ranked.resize(lines);
+    return ranked;
+}
+
+// Print the top `lines` moves for each position in a file of
+// "white black kings w|b" lines (anything after the side to move is ignored)
+bool analysePositions(const std::string& path, int depth, int lines) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string white, black, kings, side;
+        if (!(fields >> white >> black >> kings >> side))
+            continue;
+        GameState state;
+        state.white = static_cast<Bitboard>(std::stoul(white, nullptr, 0));
+        state.black = static_cast<Bitboard>(std::stoul(black, nullptr, 0));
+        state.kings = static_cast<Bitboard>(std::stoul(kings, nullptr, 0));
+        state.whiteToMove = (side == "w");
+        state.updateEmpty();
+        state.hash = computeInitialHash(state);
+        state.menHash = computeMenHash(state);
+        state.flippedHash = computeFlippedHash(state);
+#ifdef CHECKERS_NNUE
+        nnueRefresh(state);
+#endif
+        std::cout << white << " " << black << " " << kings << " " << side << "\n";
+        if (generateMoves(state).count == 0) {
+            std::cout << "  no legal moves\n";
+            continue;
+        }
+        std::vector<SearchResult> results = searchMultiPv(state, depth, lines);
+        for (size_t i = 0; i < results.size(); i++)
+            std::cout << "  " << i + 1 << ". score " << results[i].score << " pv " << pvString(results[i].pv) << "\n";
+        std::cout << "  " << searchStatsLine(searchStats) << std::endl;
+    }
+    return true;
+}
+
+// Starting position; which colour moves first is up to the server
+GameState initialPosition(bool whiteToMove) {
+    GameState state;
+    state.white = 0x00000FFF;
+    state.black = 0xFFF00000;
+    state.whiteToMove = whiteToMove;
+    state.updateEmpty();
+    state.hash = computeInitialHash(state);
+    state.menHash = computeMenHash(state);
+    state.flippedHash = computeFlippedHash(state);
+#ifdef CHECKERS_NNUE
+    nnueRefresh(state);
+#endif
+    return state;
+}
+
+// Book building: every position reached so far is searched with multi-PV,
+// moves within BOOK_MARGIN of the best go into the book weighted by how
+// close they are, and the positions they lead to are expanded on the next
+// ply. Searches run in parallel, each with its own transposition table.
+constexpr int BOOK_LINES = 3;
+constexpr int BOOK_MARGIN = 30;
+constexpr size_t BOOK_TT_ENTRIES = 1 << 22;
+
+bool buildOpeningBook(const std::string& path, int plies, int depth, int threads) {
+    std::vector<GameState> frontier;
+    std::unordered_set<uint64_t> seen;
+    for (bool whiteToMove : { true, false }) {
+        GameState start = initialPosition(whiteToMove);
+        if (seen.insert(bookKey(start, canonicalHashing)).second)
+            frontier.push_back(start);
+    }
+    std::vector<BookEntry> book;
+    for (int ply = 0; ply < plies && !frontier.empty(); ply++) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<SearchResult>> results(frontier.size());
+        std::atomic<size_t> next = 0;
+        parallelFor(static_cast<size_t>(threads), threads, [&](int, size_t, size_t) {
+            TranspositionTable tt(BOOK_TT_ENTRIES);
+            for (size_t i; (i = next++) < frontier.size();) {
+                if (generateMoves(frontier[i]).count > 0)
+                    results[i] = searchMultiPv(frontier[i], depth, BOOK_LINES, tt);
+            }
+        });
+
+        std::vector<GameState> expanded;
+        for (size_t i = 0; i < frontier.size(); i++) {
+            const GameState& state = frontier[i];
+            bool flipped = bookKeyFlipped(state, canonicalHashing);
+            uint64_t key = bookKey(state, canonicalHashing);
+            for (const SearchResult& line : results[i]) {
+                int loss = std::abs(line.score - results[i][0].score);
+                if (loss > BOOK_MARGIN)
+                    break;
+                uint16_t weight = static_cast<uint16_t>(100 * (BOOK_MARGIN + 1 - loss) / (BOOK_MARGIN + 1));
+                const Move& move = line.bestMove;
+                book.push_back({ key, flipped ? -line.score : line.score, std::max<uint16_t>(weight, 1),
+                                 flipped ? flipSquare(move.from) : move.from,
+                                 flipped ? flipSquare(move.to) : move.to });
+                GameState child = applyMove(state, line.bestMove);
+                if (seen.insert(bookKey(child, canonicalHashing)).second)
+                    expanded.push_back(child);
             }
         }
-        else {
-            if (moveValue < bestValue) {
-                bestValue = moveValue;
-                bestMove = *m;
-                beta = std::min(beta, bestValue);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Ply " << ply + 1 << ": searched " << frontier.size() << " positions, "
+                  << book.size() << " book moves (" << seconds << "s)" << std::endl;
+        frontier = std::move(expanded);
+    }
+
+    std::sort(book.begin(), book.end(), [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; });
+    std::ofstream out(path, std::ios::binary);
+    BookFileHeader header = { BOOK_FILE_MAGIC, BOOK_FILE_VERSION, canonicalHashing ? BOOK_CANONICAL : 0, 0,
+                              book.size() };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(book.data()), book.size() * sizeof(BookEntry));
+    return static_cast<bool>(out);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+// ProbCut calibration
+//////////////////////////////////////////////////////////////////////////////
+
+// Least-squares fit of deep = slope * shallow + intercept over a log written
+// with --probcut-log, overall and per depth; sigma is the residual standard
+// deviation. Prints the fit as --search-param options; fails if the shallow
+// scores never vary, and skips depths where they do not.
+bool fitProbcut(const std::string& path) {
+    struct Fit {
+        double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+        void add(double x, double y) { n++; sx += x; sy += y; sxx += x * x; sxy += x * y; syy += y * y; }
+        // A line needs at least two distinct shallow scores
+        bool fits() const { return n >= 2 && n * sxx - sx * sx > 0; }
+        double slope() const { return (n * sxy - sx * sy) / (n * sxx - sx * sx); }
+        double intercept() const { return (sy - slope() * sx) / n; }
+        double sigma() const {
+            double a = slope(), b = intercept();
+            // sum (y - a x - b)^2, expanded
+            double sse = syy - 2 * a * sxy - 2 * b * sy + a * a * sxx + 2 * a * b * sx + b * b * n;
+            return std::sqrt(std::max(0.0, sse / n));
+        }
+    };
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    Fit all;
+    std::vector<Fit> byDepth(MAX_PLY);
+    int depth, shallow, deep;
+    while (in >> depth >> shallow >> deep) {
+        all.add(shallow, deep);
+        byDepth[std::clamp(depth, 0, MAX_PLY - 1)].add(shallow, deep);
+    }
+    if (!all.fits())
+        return false;
+    std::cout << std::fixed << std::setprecision(3);
+    for (int d = 0; d < MAX_PLY; d++) {
+        if (byDepth[d].fits())
+            std::cout << "depth " << d << ": " << static_cast<uint64_t>(byDepth[d].n) << " samples, slope "
+                      << byDepth[d].slope() << ", intercept " << byDepth[d].intercept() << ", sigma "
+                      << byDepth[d].sigma() << "\n";
+    }
+    std::cout << "all: " << static_cast<uint64_t>(all.n) << " samples, slope " << all.slope() << ", intercept "
+              << all.intercept() << ", sigma " << all.sigma() << "\n"
+              << "--search-param probcut_slope " << std::lround(all.slope() * 100)
+              << " --search-param probcut_intercept " << std::lround(all.intercept())
+              << " --search-param probcut_sigma " << std::lround(all.sigma()) << std::endl;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Evaluation tuner
+//////////////////////////////////////////////////////////////////////////////
+
+// Texel-style tuning: evaluateState is linear in evalWeights, so each training
+// position is reduced once to its feature counts (see extractEvalFeatures) and
+// the weights are fitted by minimising the logistic loss
+//     -[r log p + (1 - r) log(1 - p)],  p = sigmoid(K * eval)
+// against the game results r, with full-batch Adam over all cores.
+
+// Training positions, one per line:
+//     <white> <black> <kings> <w|b> <result>
+// bitboards in decimal or 0x hex, result from white's view (1, 0.5 or 0).
+struct TuningSet {
+    std::vector<int16_t> features;  // size() x NUM_EVAL_PARAMS, row-major
+    std::vector<float> results;
+    size_t size() const { return results.size(); }
+};
+
+bool loadTuningSet(const std::string& path, TuningSet& set) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string white, black, kings, side;
+    float result;
+    size_t skipped = 0;
+    EvalFeatures f;
+    while (in >> white >> black >> kings >> side >> result) {
+        GameState state;
+        state.white = static_cast<Bitboard>(std::stoul(white, nullptr, 0));
+        state.black = static_cast<Bitboard>(std::stoul(black, nullptr, 0));
+        state.kings = static_cast<Bitboard>(std::stoul(kings, nullptr, 0));
+        state.whiteToMove = (side == "w");
+        state.updateEmpty();
+        if (state.white == 0 || state.black == 0 || (state.white & state.black)) {
+            skipped++;
+            continue;
+        }
+        extractEvalFeatures(state, f);
+        set.features.insert(set.features.end(), f.begin(), f.end());
+        set.results.push_back(result);
+    }
+    std::cout << "Loaded " << set.size() << " positions (" << skipped << " skipped)" << std::endl;
+    return set.size() > 0;
+}
+
+// Mean loss over the set; fills gradient (d loss / d weight) when given
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// One position's eval: its feature counts dotted with the weights, eight
+// lanes at a time where AVX2 is available
+inline float tuningEval(const int16_t* f, const float* weights) noexcept {
+    float eval = 0.0f;
+    int j = 0;
+#if defined(__AVX2__)
+    __m256 sum = _mm256_setzero_ps();
+    for (; j + 8 <= NUM_EVAL_PARAMS; j += 8) {
+        __m128i counts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f + j));
+        __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(counts));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(x, _mm256_loadu_ps(weights + j)));
+    }
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    eval = _mm_cvtss_f32(s);
+#endif
+    for (; j < NUM_EVAL_PARAMS; j++)
+        eval += f[j] * weights[j];
+    return eval;
+}
+
+// Gradients are summed in float over blocks of TUNING_BLOCK positions (an
+// elementwise loop the compiler vectorises) and each block is added into
+// double, so millions of positions do not drown the small terms
+constexpr size_t TUNING_BLOCK = 4096;
+
+double tuningLoss(const TuningSet& set, const std::array<float, NUM_EVAL_PARAMS>& weights,
+                  double scale, int threads, std::array<double, NUM_EVAL_PARAMS>* gradient) {
+    std::vector<double> losses(threads, 0.0);
+    std::vector<std::array<double, NUM_EVAL_PARAMS>> gradients(threads);
+    parallelFor(set.size(), threads, [&](int t, size_t begin, size_t end) {
+        std::array<double, NUM_EVAL_PARAMS> grad{};
+        std::array<float, NUM_EVAL_PARAMS> blockGrad{};
+        auto flush = [&] {
+            for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+                grad[j] += blockGrad[j];
+            blockGrad.fill(0.0f);
+        };
+        double loss = 0.0;
+        for (size_t i = begin; i < end; i++) {
+            const int16_t* f = &set.features[i * NUM_EVAL_PARAMS];
+            float eval = tuningEval(f, weights.data());
+            double p = 1.0 / (1.0 + std::exp(-scale * eval));
+            p = std::clamp(p, 1e-7, 1.0 - 1e-7);
+            double r = set.results[i];
+            loss -= r * std::log(p) + (1.0 - r) * std::log(1.0 - p);
+            if (gradient) {
+                float g = static_cast<float>((p - r) * scale);
+                for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+                    blockGrad[j] += g * f[j];
+                if ((i - begin + 1) % TUNING_BLOCK == 0)
+                    flush();
             }
         }
+        flush();
+        losses[t] = loss;
+        gradients[t] = grad;
+    });
+    double loss = 0.0;
+    if (gradient)
+        gradient->fill(0.0);
+    for (int t = 0; t < threads; t++) {
+        loss += losses[t];
+        if (gradient)
+            for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+                (*gradient)[j] += gradients[t][j] / set.size();
     }
+    return loss / set.size();
+}
 
-    //// Select randomly from best moves
-    //if (bestMoves.size() == 1) {
-    //    return bestMoves[0];
-    //} else {
-    //    std::uniform_int_distribution<int> dist(0, bestMoves.size() - 1);
-    //    int idx = dist(rng);
-    //    return bestMoves[idx];
-    //}
-    
-    //std::cout << "Best move evaluation after repition checking: " << bestValue << "\n";
-    gameHistory->push_back(bestMove);
-    return bestMove;
+// Fit the eval -> win probability scale K for the starting weights
+double fitTuningScale(const TuningSet& set, const std::array<float, NUM_EVAL_PARAMS>& weights, int threads) {
+    double lo = std::log(1e-5), hi = std::log(1e-1);
+    for (int i = 0; i < 40; i++) {
+        double m1 = lo + (hi - lo) / 3, m2 = hi - (hi - lo) / 3;
+        if (tuningLoss(set, weights, std::exp(m1), threads, nullptr) <
+            tuningLoss(set, weights, std::exp(m2), threads, nullptr))
+            hi = m2;
+        else
+            lo = m1;
+    }
+    return std::exp((lo + hi) / 2);
 }
 
+EvalWeights tuneEvalWeights(const TuningSet& set, const EvalWeights& start, int iterations, int threads) {
+    std::array<float, NUM_EVAL_PARAMS> weights;
+    for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+        weights[j] = static_cast<float>(start[j]);
+    double scale = fitTuningScale(set, weights, threads);
+    std::cout << "Scale K = " << scale << ", initial loss "
+              << tuningLoss(set, weights, scale, threads, nullptr) << std::endl;
+
+    // Adam; step sizes are in evaluation points
+    const double learningRate = 1.0, beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    std::array<double, NUM_EVAL_PARAMS> m{}, v{}, gradient;
+    for (int it = 1; it <= iterations; it++) {
+        double loss = tuningLoss(set, weights, scale, threads, &gradient);
+        for (int j = 0; j < NUM_EVAL_PARAMS; j++) {
+            m[j] = beta1 * m[j] + (1 - beta1) * gradient[j];
+            v[j] = beta2 * v[j] + (1 - beta2) * gradient[j] * gradient[j];
+            double mHat = m[j] / (1 - std::pow(beta1, it));
+            double vHat = v[j] / (1 - std::pow(beta2, it));
+            weights[j] -= static_cast<float>(learningRate * mHat / (std::sqrt(vHat) + epsilon));
+        }
+        if (it % 100 == 0 || it == iterations)
+            std::cout << "Iteration " << it << " loss " << loss << std::endl;
+    }
 
+    EvalWeights tuned;
+    for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+        tuned[j] = static_cast<int>(std::lround(weights[j]));
+    return tuned;
+}
 
 inline bool isKing(uint8_t from, GameState state) {
     Bitboard piece = 1U << from;
@@ -1063,6 +4354,7 @@ inline bool isKing(uint8_t from, GameState state) {
 // Previously, board[0] held white pieces (top rows) and board[1] held black pieces (bottom rows).
 // Now that we want white on top and black at the bottom, we assign directly:
 void updateGameStateFromJSON(const sio::message::ptr &msg, GameState &state) {
+    GameState previous = state;
     // Reset state.
     state.white = 0;
     state.black = 0;
@@ -1110,7 +4402,21 @@ void updateGameStateFromJSON(const sio::message::ptr &msg, GameState &state) {
         }
     }
     state.updateEmpty();
+    // The server does not send the no-progress count, so keep it here: a new
+    // board with the same men and no fewer pieces is one more quiet ply
+    if (state.white != previous.white || state.black != previous.black || state.kings != previous.kings) {
+        bool quiet = (state.white & ~state.kings) == (previous.white & ~previous.kings) &&
+                     (state.black & ~state.kings) == (previous.black & ~previous.kings) &&
+                     std::popcount(state.occupied()) == std::popcount(previous.occupied());
+        state.quietPlies = quiet ? std::min(previous.quietPlies + 1, NO_PROGRESS_PLIES) : 0;
+    }
     state.hash = computeInitialHash(state);
+    state.menHash = computeMenHash(state);
+    state.flippedHash = computeFlippedHash(state);
+#ifdef CHECKERS_NNUE
+    if (nnue.loaded)
+        nnueRefresh(state);
+#endif
     std::cout << "GameState updated from board JSON." << std::endl;
     //printGameState(state);
 }
@@ -1126,11 +4432,25 @@ public:
     GameState gameState;
     bool isWhite;
     int searchDepth=1;
+    std::string statsJsonPath;  // Append per-move search statistics here (JSON lines)
 	std::vector<Move> moveHistoryWhite;  // Track white state hashes 
 	std::vector<Move> moveHistoryBlack;  // Track black state hashes
 
     CheckersClient() { }
 
+    // Log the last search's statistics and emit them as a JSON record
+    void reportSearchStats(const SearchStats& stats) {
+        std::cout << "Search: " << searchStatsLine(stats) << "\n";
+        std::string json = searchStatsJson(stats);
+        if (statsJsonPath.empty()) {
+            std::cout << json << "\n";
+        } else {
+            std::ofstream out(statsJsonPath, std::ios::app);
+            out << json << "\n";
+        }
+        egdb.cache.resetStats();
+    }
+
     // Connect to the Socket.IO server.
     void connectToServer(const std::string &url) {
         client.set_open_listener([this]() {
@@ -1178,12 +4498,20 @@ public:
             std::cout << "It's our turn now." << std::endl;
             try {
                 gameState.whiteToMove = isWhite;
+                gameState.hash = computeInitialHash(gameState);  // The side to move is part of the hash
+                gameState.flippedHash = computeFlippedHash(gameState);
 				auto start = std::chrono::high_resolution_clock::now();
-                Move bestMove = findBestMove(gameState, searchDepth,isWhite?&moveHistoryWhite:&moveHistoryBlack);
+                SearchResult result = findBestMove(gameState, searchDepth,isWhite?&moveHistoryWhite:&moveHistoryBlack);
+                Move bestMove = result.bestMove;
                 gameState = applyMove(gameState, bestMove);
 				auto end = std::chrono::high_resolution_clock::now();
-				double duration_sec = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
-                std::cout << "Computed best move: " << bestMove<<" in " <<duration_sec<<"s\n";
+				double duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+				double duration_sec = duration_ms / 1000.0;
+                std::cout << "Computed best move: " << bestMove << " in " << duration_ms << " ms"
+                          << (searchStats.depth == 0 ? " (no search)" : "") << "\n";
+                std::cout << "Score " << result.score << " at depth " << result.depth
+                          << ", PV: " << pvString(result.pv) << "\n";
+                reportSearchStats(searchStats);
 
                 // Build JSON message to send the move.
                 auto moveMsg = sio::object_message::create();
@@ -1211,17 +4539,241 @@ public:
 // Main
 //////////////////////////////////////////////////////////////////////////////
 
-int main() {
+volatile std::sig_atomic_t stopRequested = 0;
+
+int main(int argc, char* argv[]) {
+    std::string statsJsonPath;
+    std::string ttSavePath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--patterns" && i + 1 < argc) {
+            // Replace the generated pattern tables with a tuned set
+            if (!loadPatternTables(argv[++i])) {
+                std::cerr << "Could not load pattern tables from " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--nnue" && i + 1 < argc) {
+#ifdef CHECKERS_NNUE
+            if (!loadNnue(argv[++i])) {
+                std::cerr << "Could not load NNUE network from " << argv[i] << std::endl;
+                return 1;
+            }
+#else
+            std::cerr << "This build has no NNUE support (define CHECKERS_NNUE)" << std::endl;
+            return 1;
+#endif
+        } else if (arg == "--eval-cache" && i + 1 < argc) {
+            // Number of eval cache entries (power of two)
+            try {
+                evalCache.resize(std::stoull(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid eval cache size: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--weights" && i + 1 < argc) {
+            // Evaluation weights for experiments; also regenerates the pattern tables
+#ifdef CHECKERS_BAKED_WEIGHTS
+            std::cerr << "This build has baked-in weights (CHECKERS_BAKED_WEIGHTS)" << std::endl;
+            return 1;
+#else
+            EvalWeights weights = evalWeights;
+            if (!loadEvalWeights(argv[++i], weights)) {
+                std::cerr << "Could not load evaluation weights from " << argv[i] << std::endl;
+                return 1;
+            }
+            if (!patternTablesFit(weights)) {
+                std::cerr << "Evaluation weights in " << argv[i] << " overflow the pattern tables" << std::endl;
+                return 1;
+            }
+            evalWeights = weights;
+            patternTables = generatePatternTables(evalWeights);
+#endif
+        } else if (arg == "--bake-weights" && i + 2 < argc) {
+            // --bake-weights <weights file> <header>: prepare a CHECKERS_BAKED_WEIGHTS build
+            EvalWeights weights = defaultEvalWeights;
+            std::string input = argv[++i];
+            std::string output = argv[++i];
+            if (!loadEvalWeights(input, weights) || !patternTablesFit(weights) || !bakeEvalWeights(output, weights)) {
+                std::cerr << "Could not bake weights from " << input << " into " << output << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--tune" && i + 2 < argc) {
+            // --tune <positions> <output weights> [iterations]
+            std::string dataset = argv[++i];
+            std::string output = argv[++i];
+            int iterations = (i + 1 < argc && argv[i + 1][0] != '-') ? std::atoi(argv[++i]) : 1000;
+            int threads = std::max(1U, std::thread::hardware_concurrency());
+            TuningSet set;
+            if (!loadTuningSet(dataset, set)) {
+                std::cerr << "Could not load tuning positions from " << dataset << std::endl;
+                return 1;
+            }
+            EvalWeights tuned = tuneEvalWeights(set, evalWeights, iterations, threads);
+            if (!patternTablesFit(tuned)) {
+                std::cerr << "Tuned weights overflow the pattern tables; not saved" << std::endl;
+                return 1;
+            }
+            if (!saveEvalWeights(output, tuned)) {
+                std::cerr << "Could not write weights to " << output << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--save-patterns" && i + 1 < argc) {
+            // Dump the tables in use, e.g. as a starting point for tuning
+            if (!savePatternTables(argv[++i])) {
+                std::cerr << "Could not write pattern tables to " << argv[i] << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--analyse" && i + 3 < argc) {
+            // --analyse <positions> <depth> <lines>: multi-PV analysis, then exit
+            std::string positions = argv[++i];
+            int depth = std::atoi(argv[++i]);
+            int lines = std::atoi(argv[++i]);
+            if (depth < 1 || lines < 1 || !analysePositions(positions, depth, lines)) {
+                std::cerr << "Could not analyse positions from " << positions << std::endl;
+                return 1;
+            }
+            if (!ttSavePath.empty() && !transpositionTable.save(ttSavePath)) {
+                std::cerr << "Could not save transposition table to " << ttSavePath << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--probcut-log" && i + 1 < argc) {
+            // Log shallow/deep score pairs from every search instead of cutting
+            probcutLog.open(argv[++i], std::ios::app);
+            if (!probcutLog) {
+                std::cerr << "Could not open ProbCut log " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--fit-probcut" && i + 1 < argc) {
+            // Fit the ProbCut model to a --probcut-log file, then exit
+            if (!fitProbcut(argv[++i])) {
+                std::cerr << "Could not fit ProbCut parameters from " << argv[i] << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--search-param" && i + 2 < argc) {
+            // --search-param <name> <value>, see SearchParams
+            std::string name = argv[++i];
+            if (!setSearchParam(name, std::atoi(argv[++i]))) {
+                std::cerr << "Unknown search parameter: " << name << std::endl;
+                return 1;
+            }
+        } else if (arg == "--egdb" && i + 1 < argc) {
+            // Endgame tables written by --build-egdb
+            std::string dir = argv[++i];
+            int loaded = loadEndgameDatabase(dir, EGDB_MAX_PIECES);
+            std::cout << "Loaded " << loaded << " endgame tables from " << dir << ", probing at "
+                      << egdb.maxPieces << " pieces or fewer" << std::endl;
+        } else if (arg == "--egdb-cache" && i + 1 < argc) {
+            // Decoded endgame blocks kept in memory, in MB
+            egdb.cache.capacity = std::max(1, std::atoi(argv[++i])) * size_t(1 << 20) /
+                                  (EGDB_BLOCK_POSITIONS / 4);
+        } else if (arg == "--build-egdb" && i + 2 < argc) {
+            // --build-egdb <dir> <pieces>: retrograde WDL tables for up to <pieces> pieces
+            std::string dir = argv[++i];
+            int pieces = std::atoi(argv[++i]);
+            int threads = std::max(1U, std::thread::hardware_concurrency());
+            if (pieces < 2 || pieces > EGDB_MAX_PIECES || !buildEndgameDatabase(dir, pieces, threads)) {
+                std::cerr << "Could not build endgame tables in " << dir << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--dtw" && i + 1 < argc) {
+            // Distance-to-win tables written by --build-dtw
+            std::string dir = argv[++i];
+            int loaded = loadDtwTables(dir, EGDB_MAX_PIECES);
+            std::cout << "Loaded " << loaded << " distance-to-win tables from " << dir
+                      << ", converting wins at " << dtw.maxPieces << " pieces or fewer" << std::endl;
+        } else if (arg == "--build-dtw" && i + 2 < argc) {
+            // --build-dtw <dir> <pieces>: distance-to-win tables for the smallest endgames
+            std::string dir = argv[++i];
+            int pieces = std::atoi(argv[++i]);
+            int threads = std::max(1U, std::thread::hardware_concurrency());
+            if (pieces < 2 || pieces > EGDB_MAX_PIECES || !buildDtwTables(dir, pieces, threads)) {
+                std::cerr << "Could not build distance-to-win tables in " << dir << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--book" && i + 1 < argc) {
+            // Opening book written by --build-book
+            if (!openingBook.open(argv[++i])) {
+                std::cerr << "Could not open opening book " << argv[i] << std::endl;
+                return 1;
+            }
+            std::cout << "Opening book: " << openingBook.count << " moves" << std::endl;
+        } else if (arg == "--build-book" && i + 3 < argc) {
+            // --build-book <output> <plies> <depth>: expand a book by self-play searches
+            std::string output = argv[++i];
+            int plies = std::atoi(argv[++i]);
+            int depth = std::atoi(argv[++i]);
+            int threads = std::max(1U, std::thread::hardware_concurrency());
+            if (plies < 1 || depth < 1 || !buildOpeningBook(output, plies, depth, threads)) {
+                std::cerr << "Could not build opening book " << output << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--move-cache" && i + 1 < argc) {
+            // --move-cache <file> [entries]: root results kept across runs
+            std::string path = argv[++i];
+            uint64_t entries = (i + 1 < argc && argv[i + 1][0] != '-') ? std::stoull(argv[++i]) : 1ULL << 20;
+            if (!moveCache.open(path, entries)) {
+                std::cerr << "Could not open move cache " << path << std::endl;
+                return 1;
+            }
+        } else if (arg == "--canonical-hash") {
+            // Share cache and book entries between colour-flipped positions;
+            // black-to-move positions are then evaluated as their twin
+            canonicalHashing = true;
+        } else if (arg == "--tt-size" && i + 1 < argc) {
+            // --tt-size <entries>: transposition table size, a power of two
+            uint64_t entries = std::stoull(argv[++i]);
+            if (entries == 0 || (entries & (entries - 1))) {
+                std::cerr << "Transposition table size must be a power of two" << std::endl;
+                return 1;
+            }
+            transpositionTable.resize(entries);
+        } else if (arg == "--tt-load" && i + 1 < argc) {
+            // Start from a snapshot written by --tt-save; it sets the table size.
+            // --canonical-hash must come first if the snapshot was saved with it
+            if (!transpositionTable.load(argv[++i])) {
+                std::cerr << "Could not load transposition table " << argv[i] << std::endl;
+                return 1;
+            }
+            std::cout << "Transposition table: " << transpositionTable.size() << " entries from "
+                      << argv[i] << std::endl;
+        } else if (arg == "--tt-save" && i + 1 < argc) {
+            // Snapshot the transposition table on exit; must come before --analyse
+            ttSavePath = argv[++i];
+        } else if (arg == "--stats-json" && i + 1 < argc) {
+            // Append one JSON record of search statistics per move instead of printing it
+            statsJsonPath = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
     CheckersClient cc;
+    cc.statsJsonPath = statsJsonPath;
     cc.connectToServer("http://localhost:3001");
     cc.setupListeners();
 
-    // Keep the client running.
-    while (true) {
+    // Keep the client running until interrupted, then shut down cleanly so
+    // exit-time reports (e.g. the evaluation profile) get written.
+    std::signal(SIGINT, [](int) { stopRequested = true; });
+    std::signal(SIGTERM, [](int) { stopRequested = true; });
+    while (!stopRequested) {
          std::this_thread::sleep_for(std::chrono::seconds(1));
     }
     cc.client.sync_close();
     cc.client.clear_con_listeners();
+    if (!ttSavePath.empty() && !transpositionTable.save(ttSavePath)) {
+        std::cerr << "Could not save transposition table to " << ttSavePath << std::endl;
+        return 1;
+    }
     return 0;
 }
 